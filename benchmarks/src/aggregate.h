@@ -0,0 +1,219 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_AGGREGATE_H
+#define UP_ZENOH_EXAMPLE_CPP_AGGREGATE_H
+
+#include "utils.h"
+#include "filesys.h"
+#include <atomic>
+#include <thread>
+
+constexpr size_t AGGREGATE_MIN_CHUNK = 1 << 16; // smaller vectors are not worth a thread
+
+static inline auto getNumberOfWorkers() -> size_t {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * call func(chunk, begin, end) on about equal chunks of [0, size) on the worker threads,
+ * the caller keeps a partial result per chunk and reduces them
+ */
+template<typename F>
+static inline auto parallelChunks(size_t size, F &&func) -> size_t {
+    auto chunks = std::min(getNumberOfWorkers(), std::max<size_t>(1, size / AGGREGATE_MIN_CHUNK));
+    std::vector<std::thread> threads {};
+    auto chunk_size = (size + chunks - 1) / chunks;
+    for (size_t c = 1; c < chunks; c++) {
+        threads.emplace_back([&, c]() {
+            func(c, c * chunk_size, std::min(size, (c + 1) * chunk_size));
+        });
+    }
+    func(0, 0, std::min(size, chunk_size));
+    for (auto &t : threads) {
+        t.join();
+    }
+    return chunks;
+}
+
+/**
+ * load every file into its own vector, the workers take the next file from a shared index
+ */
+static inline auto loadFilesParallel(const std::vector<std::filesystem::path> &files) -> std::vector<std::vector<double>> {
+    std::vector<std::vector<double>> res(files.size());
+    std::atomic<size_t> next {0};
+    auto worker = [&]() {
+        for (auto i = next.fetch_add(1); i < files.size(); i = next.fetch_add(1)) {
+            readFileToVecFast(files[i], res[i]);
+        }
+    };
+    std::vector<std::thread> threads {};
+    auto workers = std::min(getNumberOfWorkers(), files.size());
+    for (size_t i = 1; i < workers; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads) {
+        t.join();
+    }
+    return res;
+}
+
+static inline auto concat(std::vector<std::vector<double>> &vecs) -> std::vector<double> {
+    size_t size = 0;
+    for (auto const &v : vecs) {
+        size += v.size();
+    }
+    std::vector<double> res {};
+    res.reserve(size);
+    for (auto const &v : vecs) {
+        res.insert(res.end(), v.begin(), v.end());
+    }
+    return res;
+}
+
+/**
+ * the same values as getPercentileFromSortedVec without sorting, nth_element places every rank
+ * that is needed, one after the other on the part of the vector after the previous rank
+ */
+static inline auto selectPercentiles(std::vector<double> &vec, const std::vector<int> &percentiles) -> std::vector<double> {
+    std::vector<size_t> ranks {};
+    for (auto p : percentiles) {
+        double index = ((double)p / 100) * (vec.size() - 1) + 1;
+        auto i = static_cast<size_t>(index);
+        ranks.push_back(i - 1);
+        if (i < vec.size()) {
+            ranks.push_back(i);
+        }
+    }
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+    auto lo = vec.begin();
+    for (auto r : ranks) {
+        std::nth_element(lo, vec.begin() + r, vec.end());
+        lo = vec.begin() + r + 1;
+    }
+
+    std::vector<double> res {};
+    for (auto p : percentiles) {
+        double index = ((double)p / 100) * (vec.size() - 1) + 1;
+        if (index == (int)index) {
+            res.push_back(vec[(int)index - 1]);
+        } else {
+            int i = (int)index;
+            double delta = index - i;
+            res.push_back(vec[i - 1] + delta * (vec[i] - vec[i - 1]));
+        }
+    }
+    return res;
+}
+
+struct moments_s {
+    double mean;
+    double min;
+    double max;
+    double variance;
+    double m4;
+};
+
+/**
+ * mean, min and max in one parallel pass, the central moments in a second one
+ */
+static inline auto getMomentsParallel(const std::vector<double> &vec) -> moments_s {
+    auto workers = getNumberOfWorkers();
+    std::vector<double> sums(workers, 0.0);
+    std::vector<double> mins(workers, vec[0]);
+    std::vector<double> maxs(workers, vec[0]);
+    auto chunks = parallelChunks(vec.size(), [&](size_t c, size_t begin, size_t end) {
+        double sum = 0;
+        double min = vec[begin];
+        double max = vec[begin];
+        for (auto i = begin; i < end; i++) {
+            sum += vec[i];
+            min = std::min(min, vec[i]);
+            max = std::max(max, vec[i]);
+        }
+        sums[c] = sum;
+        mins[c] = min;
+        maxs[c] = max;
+    });
+    moments_s res {};
+    res.mean = std::accumulate(sums.begin(), sums.begin() + chunks, 0.0) / vec.size();
+    res.min = *std::min_element(mins.begin(), mins.begin() + chunks);
+    res.max = *std::max_element(maxs.begin(), maxs.begin() + chunks);
+
+    std::vector<double> m2(workers, 0.0);
+    std::vector<double> m4(workers, 0.0);
+    parallelChunks(vec.size(), [&](size_t c, size_t begin, size_t end) {
+        double sum2 = 0;
+        double sum4 = 0;
+        for (auto i = begin; i < end; i++) {
+            auto d = vec[i] - res.mean;
+            auto d2 = d * d;
+            sum2 += d2;
+            sum4 += d2 * d2;
+        }
+        m2[c] = sum2;
+        m4[c] = sum4;
+    });
+    res.variance = std::accumulate(m2.begin(), m2.begin() + chunks, 0.0) / vec.size();
+    res.m4 = std::accumulate(m4.begin(), m4.begin() + chunks, 0.0) / vec.size();
+    return res;
+}
+
+/**
+ * getStats for big vectors, the moments are reduced on the worker threads and the
+ * percentiles are selected with nth_element (O(n) instead of the O(n log n) sort),
+ * vec is reordered but not sorted
+ */
+static inline auto getStatsParallel(std::vector<double> &vec) -> std::optional<Stat_s> {
+    if (vec.size() < 2) {
+        return std::nullopt;
+    }
+    auto m = getMomentsParallel(vec);
+    auto percentiles = selectPercentiles(vec, {50, 75, 90, 95, 99});
+
+    Stat_s stat {};
+    stat.mean = m.mean;
+    stat.min = m.min;
+    stat.max = m.max;
+    stat.median = percentiles[0];
+    stat.precentile_75 = percentiles[1];
+    stat.precentile_90 = percentiles[2];
+    stat.precentile_95 = percentiles[3];
+    stat.precentile_99 = percentiles[4];
+    stat.std = std::sqrt(m.variance);
+    if (vec.size() >= 3 && stat.std.value() > 0) {
+        stat.skew = (3 * (m.mean - stat.median.value())) / stat.std.value();
+        stat.kurtosis = m.m4 / (m.variance * m.variance) - 3;
+    } else if (vec.size() >= 3) {
+        // constant samples, 0 like getSkew and getKurtosis in getStats instead of 0 / 0
+        stat.skew = 0.0;
+        stat.kurtosis = 0.0;
+    }
+    return stat;
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_AGGREGATE_H
@@ -0,0 +1,261 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+// the library only needs the counters, the file functions pull in the globals of utils.h
+#define ALLOC_TRACE_LIBRARY
+#include "alloc_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <new>
+
+/**
+ * operator new/delete and the malloc family of the process end up here, operator new calls the glibc
+ * allocator directly so an allocation is counted once, the counters of a thread are a slot of a static
+ * array so counting never allocates itself
+ */
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+constexpr size_t ALLOC_TRACE_MAX_THREADS = 1024;
+
+struct alloc_thread_s {
+    std::atomic<uint64_t> allocs;
+    std::atomic<uint64_t> frees;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> classes[ALLOC_TRACE_CLASSES];
+};
+
+static alloc_thread_s alloc_threads[ALLOC_TRACE_MAX_THREADS + 1]; // the last one is shared by the threads that don't get a slot
+static std::atomic<size_t> alloc_threads_used {0};
+static thread_local alloc_thread_s *alloc_thread __attribute__((tls_model("initial-exec"))) = nullptr;
+
+static inline auto getSizeClass(size_t size) -> size_t {
+    size_t size_class = 0;
+    for (size_t limit = 16; size > limit && size_class < ALLOC_TRACE_CLASSES - 1; limit <<= 1) {
+        size_class++;
+    }
+    return size_class;
+}
+
+static inline auto getThreadSlot() -> alloc_thread_s* {
+    if (alloc_thread == nullptr) {
+        auto slot = alloc_threads_used.fetch_add(1, std::memory_order_relaxed);
+        alloc_thread = &alloc_threads[slot < ALLOC_TRACE_MAX_THREADS ? slot : ALLOC_TRACE_MAX_THREADS];
+    }
+    return alloc_thread;
+}
+
+/**
+ * only the owner thread writes its slot, a relaxed load and store is enough and has no lock prefix,
+ * the shared overflow slot uses fetch_add
+ */
+static inline auto bump(std::atomic<uint64_t> &counter, uint64_t value, bool shared) -> void {
+    if (shared) {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    } else {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+}
+
+static inline auto countAlloc(size_t size) -> void {
+    auto slot = getThreadSlot();
+    auto shared = slot == &alloc_threads[ALLOC_TRACE_MAX_THREADS];
+    bump(slot->allocs, 1, shared);
+    bump(slot->bytes, size, shared);
+    bump(slot->classes[getSizeClass(size)], 1, shared);
+}
+
+static inline auto countFree(void *ptr) -> void {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto slot = getThreadSlot();
+    bump(slot->frees, 1, slot == &alloc_threads[ALLOC_TRACE_MAX_THREADS]);
+}
+
+static inline auto readSlot(const alloc_thread_s &slot, alloc_counters &res) -> void {
+    res.allocs += slot.allocs.load(std::memory_order_relaxed);
+    res.frees += slot.frees.load(std::memory_order_relaxed);
+    res.bytes += slot.bytes.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < ALLOC_TRACE_CLASSES; i++) {
+        res.classes[i] += slot.classes[i].load(std::memory_order_relaxed);
+    }
+}
+
+auto allocTraceThread() -> alloc_counters {
+    alloc_counters res {};
+    readSlot(*getThreadSlot(), res);
+    return res;
+}
+
+auto allocTraceProcess() -> alloc_counters {
+    alloc_counters res {};
+    auto used = std::min(alloc_threads_used.load(std::memory_order_relaxed), ALLOC_TRACE_MAX_THREADS);
+    for (size_t i = 0; i < used; i++) {
+        readSlot(alloc_threads[i], res);
+    }
+    readSlot(alloc_threads[ALLOC_TRACE_MAX_THREADS], res);
+    return res;
+}
+
+extern "C" {
+
+void *malloc(size_t size) {
+    countAlloc(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    countAlloc(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    countAlloc(size);
+    if (ptr != nullptr) {
+        countFree(ptr);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    countFree(ptr);
+    __libc_free(ptr);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    // the checks of glibc, __libc_memalign would round a bad alignment up instead of failing
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    countAlloc(size);
+    auto res = __libc_memalign(alignment, size);
+    if (res == nullptr) {
+        return ENOMEM;
+    }
+    *ptr = res;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    countAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    countAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+}
+
+static inline auto allocNew(size_t size) -> void* {
+    countAlloc(size);
+    if (auto ptr = __libc_malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+static inline auto allocNewAligned(size_t size, std::align_val_t alignment) -> void* {
+    countAlloc(size);
+    if (auto ptr = __libc_memalign(static_cast<size_t>(alignment), size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator new(size_t size) -> void* {
+    return allocNew(size);
+}
+
+auto operator new[](size_t size) -> void* {
+    return allocNew(size);
+}
+
+auto operator new(size_t size, const std::nothrow_t&) noexcept -> void* {
+    countAlloc(size);
+    return __libc_malloc(size == 0 ? 1 : size);
+}
+
+auto operator new[](size_t size, const std::nothrow_t&) noexcept -> void* {
+    countAlloc(size);
+    return __libc_malloc(size == 0 ? 1 : size);
+}
+
+auto operator new(size_t size, std::align_val_t alignment) -> void* {
+    return allocNewAligned(size, alignment);
+}
+
+auto operator new[](size_t size, std::align_val_t alignment) -> void* {
+    return allocNewAligned(size, alignment);
+}
+
+auto operator delete(void *ptr) noexcept -> void {
+    countFree(ptr);
+    __libc_free(ptr);
+}
+
+auto operator delete[](void *ptr) noexcept -> void {
+    countFree(ptr);
+    __libc_free(ptr);
+}
+
+auto operator delete(void *ptr, size_t) noexcept -> void {
+    countFree(ptr);
+    __libc_free(ptr);
+}
+
+auto operator delete[](void *ptr, size_t) noexcept -> void {
+    countFree(ptr);
+    __libc_free(ptr);
+}
+
+auto operator delete(void *ptr, std::align_val_t) noexcept -> void {
+    countFree(ptr);
+    __libc_free(ptr);
+}
+
+auto operator delete[](void *ptr, std::align_val_t) noexcept -> void {
+    countFree(ptr);
+    __libc_free(ptr);
+}
+
+auto operator delete(void *ptr, size_t, std::align_val_t) noexcept -> void {
+    countFree(ptr);
+    __libc_free(ptr);
+}
+
+auto operator delete[](void *ptr, size_t, std::align_val_t) noexcept -> void {
+    countFree(ptr);
+    __libc_free(ptr);
+}
@@ -0,0 +1,178 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_ALLOC_TRACE_H
+#define UP_ZENOH_EXAMPLE_CPP_ALLOC_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef ALLOC_TRACE_LIBRARY
+#include "filesys.h"
+#endif
+
+/**
+ * allocation counters of the alloc_trace library (alloc_trace.cpp), the library replaces operator new/delete
+ * and malloc/free and is linked into the benchmarks with -DBENCHMARK_ALLOC_TRACE=ON, without it the
+ * functions below are empty and allocTraceEnabled() is false
+ * size class i counts the allocations of up to 16 << i bytes, the last one everything bigger
+ */
+constexpr size_t ALLOC_TRACE_CLASSES = 14;
+const std::string ALLOC_TRACE_PREFIX = "alloc-";
+
+struct alloc_counters {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes;
+    uint64_t classes[ALLOC_TRACE_CLASSES];
+};
+
+static inline auto allocDelta(const alloc_counters &end, const alloc_counters &start) -> alloc_counters {
+    alloc_counters res {};
+    res.allocs = end.allocs - start.allocs;
+    res.frees = end.frees - start.frees;
+    res.bytes = end.bytes - start.bytes;
+    for (size_t i = 0; i < ALLOC_TRACE_CLASSES; i++) {
+        res.classes[i] = end.classes[i] - start.classes[i];
+    }
+    return res;
+}
+
+static inline auto allocAdd(alloc_counters &sum, const alloc_counters &value) -> void {
+    sum.allocs += value.allocs;
+    sum.frees += value.frees;
+    sum.bytes += value.bytes;
+    for (size_t i = 0; i < ALLOC_TRACE_CLASSES; i++) {
+        sum.classes[i] += value.classes[i];
+    }
+}
+
+#ifdef BENCHMARK_ALLOC_TRACE
+
+/**
+ * the counters of the calling thread, cheap enough to be read around every send or callback
+ */
+auto allocTraceThread() -> alloc_counters;
+
+/**
+ * the sum of the counters of all the threads of the process
+ */
+auto allocTraceProcess() -> alloc_counters;
+
+static inline constexpr auto allocTraceEnabled() -> bool {
+    return true;
+}
+
+#else
+
+static inline auto allocTraceThread() -> alloc_counters {
+    return {};
+}
+
+static inline auto allocTraceProcess() -> alloc_counters {
+    return {};
+}
+
+static inline constexpr auto allocTraceEnabled() -> bool {
+    return false;
+}
+
+#endif
+
+#ifndef ALLOC_TRACE_LIBRARY
+
+/**
+ * the steady state allocations of a process in alloc-<file_name>.csv, thread is what the transport allocated on
+ * the thread of the messages (inside send() for a publisher, on the callback thread outside the callback for a
+ * subscriber), process is all the threads between the two snapshots
+ */
+static inline auto writeAllocTrace(const std::filesystem::path &dir, const std::string &file_name, uint64_t messages,
+                                   const alloc_counters &thread, const alloc_counters &process) -> int {
+    std::stringstream out;
+    out << "scope,messages,allocs,frees,bytes";
+    for (size_t i = 0; i < ALLOC_TRACE_CLASSES - 1; i++) {
+        out << ",le_" << (16 << i);
+    }
+    out << ",gt_" << (16 << (ALLOC_TRACE_CLASSES - 2));
+    out << "\n";
+    for (auto const &e : {std::make_pair("thread", thread), std::make_pair("process", process)}) {
+        out << e.first << "," << messages << "," << e.second.allocs << "," << e.second.frees << "," << e.second.bytes;
+        for (size_t i = 0; i < ALLOC_TRACE_CLASSES; i++) {
+            out << "," << e.second.classes[i];
+        }
+        out << "\n";
+    }
+    return writeFileAtomic(dir / (ALLOC_TRACE_PREFIX + file_name + ".csv"), out.str());
+}
+
+struct alloc_report {
+    uint64_t messages;
+    alloc_counters thread;
+    alloc_counters process;
+};
+
+static inline auto readAllocTrace(const std::filesystem::path &path) -> std::optional<alloc_report> {
+    std::ifstream in(path);
+    std::string line {};
+    if (!std::getline(in, line)) {
+        return std::nullopt;
+    }
+    alloc_report res {};
+    size_t rows = 0;
+    while (std::getline(in, line)) {
+        std::stringstream s(line);
+        std::string scope {};
+        std::string value {};
+        std::getline(s, scope, ',');
+        auto &counters = scope == "thread" ? res.thread : res.process;
+        std::vector<uint64_t> values {};
+        while (std::getline(s, value, ',')) {
+            values.push_back(std::strtoull(value.c_str(), nullptr, 10));
+        }
+        if (values.size() != 4 + ALLOC_TRACE_CLASSES) {
+            return std::nullopt;
+        }
+        res.messages = values[0];
+        counters.allocs = values[1];
+        counters.frees = values[2];
+        counters.bytes = values[3];
+        for (size_t i = 0; i < ALLOC_TRACE_CLASSES; i++) {
+            counters.classes[i] = values[4 + i];
+        }
+        rows++;
+    }
+    return rows == 2 ? std::make_optional(res) : std::nullopt;
+}
+
+#endif
+
+#endif //UP_ZENOH_EXAMPLE_CPP_ALLOC_TRACE_H
@@ -0,0 +1,123 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_BUFFER_POOL_H
+#define UP_ZENOH_EXAMPLE_CPP_BUFFER_POOL_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <sys/mman.h>
+
+/**
+ * fixed number of buffers that are mapped, touched and locked once at startup
+ * so a send never pays for allocation or page faults, the buffers are used
+ * as the memory behind UPayloadType::REFERENCE payloads
+ */
+class BufferPool {
+public:
+    BufferPool(size_t count, size_t buffer_size) : buffer_size_(buffer_size) {
+        for (size_t i = 0; i < count; i++) {
+            auto ptr = mmap(nullptr, buffer_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (MAP_FAILED == ptr) {
+                break;
+            }
+            std::memset(ptr, 0, buffer_size_);
+            // locking is best effort, it fails without CAP_IPC_LOCK or a big enough RLIMIT_MEMLOCK
+            if (mlock(ptr, buffer_size_) != 0) {
+                locked_ = false;
+            }
+            buffers_.push_back(static_cast<uint8_t*>(ptr));
+        }
+        free_ = buffers_;
+        locked_ = locked_ && !buffers_.empty();
+    }
+
+    ~BufferPool() {
+        for (auto ptr : buffers_) {
+            munlock(ptr, buffer_size_);
+            munmap(ptr, buffer_size_);
+        }
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @return nullptr when all the buffers are in use
+     */
+    inline auto acquire() -> uint8_t* {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty()) {
+            return nullptr;
+        }
+        auto ptr = free_.back();
+        free_.pop_back();
+        return ptr;
+    }
+
+    inline auto release(uint8_t* ptr) -> void {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(ptr);
+    }
+
+    inline auto contains(const uint8_t* ptr) const -> bool {
+        for (auto buffer : buffers_) {
+            if (ptr >= buffer && ptr < buffer + buffer_size_) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline auto bufferSize() const -> size_t {
+        return buffer_size_;
+    }
+
+    inline auto size() const -> size_t {
+        return buffers_.size();
+    }
+
+    inline auto isLocked() const -> bool {
+        return locked_;
+    }
+
+    inline auto forEach(const std::function<void(uint8_t*, size_t)>& func) -> void {
+        for (auto buffer : buffers_) {
+            func(buffer, buffer_size_);
+        }
+    }
+
+private:
+    size_t buffer_size_;
+    bool locked_ = true;
+    std::mutex mutex_;
+    std::vector<uint8_t*> buffers_ {};
+    std::vector<uint8_t*> free_ {};
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_BUFFER_POOL_H
@@ -0,0 +1,289 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_COMPARE_H
+#define UP_ZENOH_EXAMPLE_CPP_COMPARE_H
+
+#include "utils.h"
+#include "filesys.h"
+#include "aggregate.h"
+#include <spdlog/spdlog.h>
+
+constexpr double COMPARE_ALPHA = 0.01;
+constexpr double COMPARE_MIN_SHIFT = 0.05; // ignore significant but smaller than 5% changes
+constexpr size_t COMPARE_MAX_SAMPLES = 200000;
+constexpr int COMPARE_BOOTSTRAP_ITERATIONS = 1000;
+constexpr size_t COMPARE_BOOTSTRAP_SAMPLES = 10000;
+constexpr int COMPARE_SEED = 42;
+const std::string BASELINES_DIR = "baselines";
+const std::string HISTORY_FILE = "history";
+
+struct mann_whitney_s {
+    double u;
+    double z;
+    double p_value; // one sided, the current run is slower than the baseline
+};
+
+struct bootstrap_s {
+    double diff;
+    double low;
+    double high;
+};
+
+/**
+ * keep at most max_samples (seeded) so the tests run in a bounded time on big runs
+ */
+static inline auto subsample(const std::vector<double> &vec, size_t max_samples, std::mt19937 &rnd_gen) -> std::vector<double> {
+    if (vec.size() <= max_samples) {
+        return vec;
+    }
+    std::vector<double> res(vec);
+    std::shuffle(res.begin(), res.end(), rnd_gen);
+    res.resize(max_samples);
+    return res;
+}
+
+/**
+ * Mann-Whitney U test with the normal approximation and tie correction
+ */
+static inline auto mannWhitneyU(const std::vector<double> &baseline, const std::vector<double> &current) -> std::optional<mann_whitney_s> {
+    double n1 = baseline.size();
+    double n2 = current.size();
+    if (n1 < 2 || n2 < 2) {
+        return std::nullopt;
+    }
+    std::vector<std::pair<double, int>> all {};
+    all.reserve(baseline.size() + current.size());
+    for (auto v : baseline) {
+        all.emplace_back(v, 0);
+    }
+    for (auto v : current) {
+        all.emplace_back(v, 1);
+    }
+    std::sort(all.begin(), all.end());
+
+    double rank_sum = 0; // of the current run
+    double tie_sum = 0;
+    size_t i = 0;
+    while (i < all.size()) {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) {
+            j++;
+        }
+        double rank = (i + 1 + j) / 2.0; // average rank of the ties
+        double ties = j - i;
+        tie_sum += ties * ties * ties - ties;
+        for (auto k = i; k < j; k++) {
+            if (all[k].second == 1) {
+                rank_sum += rank;
+            }
+        }
+        i = j;
+    }
+
+    mann_whitney_s res {};
+    res.u = rank_sum - n2 * (n2 + 1) / 2.0;
+    double n = n1 + n2;
+    double mean = n1 * n2 / 2.0;
+    double variance = n1 * n2 / 12.0 * ((n + 1) - tie_sum / (n * (n - 1)));
+    if (variance <= 0) {
+        return std::nullopt;
+    }
+    res.z = (res.u - mean) / std::sqrt(variance);
+    res.p_value = 0.5 * std::erfc(res.z / std::sqrt(2.0));
+    return res;
+}
+
+/**
+ * bootstrap confidence interval (95%) of the difference current - baseline of the percentile
+ */
+static inline auto bootstrapPercentileDiff(const std::vector<double> &baseline, const std::vector<double> &current, int percentile, std::mt19937 &rnd_gen) -> std::optional<bootstrap_s> {
+    if (baseline.size() < 2 || current.size() < 2) {
+        return std::nullopt;
+    }
+    auto resample = [&](const std::vector<double> &vec) {
+        std::uniform_int_distribution<size_t> distribution(0, vec.size() - 1);
+        std::vector<double> res(std::min(vec.size(), COMPARE_BOOTSTRAP_SAMPLES));
+        for (auto &e : res) {
+            e = vec[distribution(rnd_gen)];
+        }
+        std::sort(res.begin(), res.end());
+        return getPercentileFromSortedVec(res, percentile).value();
+    };
+
+    std::vector<double> base_sorted(baseline);
+    std::vector<double> curr_sorted(current);
+    std::sort(base_sorted.begin(), base_sorted.end());
+    std::sort(curr_sorted.begin(), curr_sorted.end());
+
+    bootstrap_s res {};
+    res.diff = getPercentileFromSortedVec(curr_sorted, percentile).value() - getPercentileFromSortedVec(base_sorted, percentile).value();
+    std::vector<double> diffs(COMPARE_BOOTSTRAP_ITERATIONS);
+    for (auto &d : diffs) {
+        d = resample(current) - resample(baseline);
+    }
+    std::sort(diffs.begin(), diffs.end());
+    res.low = diffs[static_cast<size_t>(0.025 * (diffs.size() - 1))];
+    res.high = diffs[static_cast<size_t>(0.975 * (diffs.size() - 1))];
+    return res;
+}
+
+/**
+ * compare one distribution (for example the subscribe latency of a scenario) with its baseline
+ * a regression is a significant Mann-Whitney U test and a p50 or p99 that is slower by more than
+ * COMPARE_MIN_SHIFT with the whole bootstrap interval above zero
+ * @return true on regression
+ */
+static inline auto compareDistribution(const std::string &name, const std::vector<double> &baseline_all, const std::vector<double> &current_all, std::string &summary) -> bool {
+    std::mt19937 rnd_gen(COMPARE_SEED);
+    auto baseline = subsample(baseline_all, COMPARE_MAX_SAMPLES, rnd_gen);
+    auto current = subsample(current_all, COMPARE_MAX_SAMPLES, rnd_gen);
+
+    auto mw = mannWhitneyU(baseline, current);
+    auto p50 = bootstrapPercentileDiff(baseline, current, 50, rnd_gen);
+    auto p99 = bootstrapPercentileDiff(baseline, current, 99, rnd_gen);
+    if (!mw.has_value() || !p50.has_value() || !p99.has_value()) {
+        spdlog::warn("{} : not enough samples to compare ({} baseline, {} current)", name, baseline.size(), current.size());
+        summary = "n/a";
+        return false;
+    }
+
+    std::sort(baseline.begin(), baseline.end());
+    auto base_p50 = getPercentileFromSortedVec(baseline, 50).value();
+    auto base_p99 = getPercentileFromSortedVec(baseline, 99).value();
+    auto shift = [](const bootstrap_s &b, double base) {
+        return b.low > 0 && base > 0 && (b.diff / base) > COMPARE_MIN_SHIFT;
+    };
+    bool regression = mw.value().p_value < COMPARE_ALPHA && (shift(p50.value(), base_p50) || shift(p99.value(), base_p99));
+
+    spdlog::info("{} : Mann-Whitney z {:.2f} p {:.4f}, p50 {:+.9f} [{:+.9f}, {:+.9f}] ({:+.1f}%), p99 {:+.9f} [{:+.9f}, {:+.9f}] ({:+.1f}%) {}",
+                 name, mw.value().z, mw.value().p_value,
+                 p50.value().diff, p50.value().low, p50.value().high, base_p50 > 0 ? 100.0 * p50.value().diff / base_p50 : 0.0,
+                 p99.value().diff, p99.value().low, p99.value().high, base_p99 > 0 ? 100.0 * p99.value().diff / base_p99 : 0.0,
+                 regression ? "REGRESSION" : "ok");
+
+    std::stringstream s;
+    s << std::fixed << std::setprecision(9) << name << " p=" << mw.value().p_value
+      << " p50=" << p50.value().diff << " p99=" << p99.value().diff << (regression ? " REGRESSION" : " ok");
+    summary = s.str();
+    return regression;
+}
+
+const std::string PUB_SAMPLES_PREFIX = "pub-";
+const std::string SUB_SAMPLES_PREFIX = "sub-";
+
+/**
+ * the sample files of pub_test and sub_test, the other files of the run (warm-up, windows, tail, allocations,
+ * traces and stages) are not samples
+ */
+static inline auto isSampleFile(const std::string &file_name) -> bool {
+    return file_name.rfind(PUB_SAMPLES_PREFIX, 0) == 0 || file_name.rfind(SUB_SAMPLES_PREFIX, 0) == 0;
+}
+
+/**
+ * the samples of the run of a scenario, prefix PUB_SAMPLES_PREFIX or SUB_SAMPLES_PREFIX
+ */
+static inline auto readScenarioSamples(const std::filesystem::path &dir, const std::string &prefix) -> std::vector<double> {
+    if (!std::filesystem::exists(dir)) {
+        return {};
+    }
+    std::vector<std::filesystem::path> files {};
+    for (auto const &file : getFilesFromDir(dir)) {
+        if (file.empty()) {
+            continue;
+        }
+        std::filesystem::path local_path(file);
+        if (local_path.filename().string().rfind(prefix, 0) == 0) {
+            files.push_back(local_path);
+        }
+    }
+    auto loaded = loadFilesParallel(files);
+    return concat(loaded);
+}
+
+static inline auto getBaselineDir(const std::string &scenario) -> std::filesystem::path {
+    return std::filesystem::current_path() / "benchmarks" / BASELINES_DIR / scenario;
+}
+
+/**
+ * replace the baseline of the scenario with the samples of this run
+ * the baselines are not in a timestamp directory so the cleanup of old runs does not remove them
+ */
+static inline auto saveBaseline(const std::string &scenario, const std::filesystem::path &run_dir) -> int {
+    auto dir = getBaselineDir(scenario);
+    try {
+        std::filesystem::create_directories(dir);
+        for (auto const &entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.is_regular_file() && entry.path().filename() != HISTORY_FILE) {
+                std::filesystem::remove(entry.path());
+            }
+        }
+        for (auto const &entry : std::filesystem::directory_iterator(run_dir)) {
+            if (entry.is_regular_file() && isSampleFile(entry.path().filename().string())) {
+                std::filesystem::copy_file(entry.path(), dir / entry.path().filename(), std::filesystem::copy_options::overwrite_existing);
+            }
+        }
+    } catch (const std::filesystem::filesystem_error &e) {
+        std::cerr << "Filesystem error : " << e.what() << std::endl;
+        return -1;
+    }
+    spdlog::info("baseline of {} saved from {}", scenario, run_dir.string());
+    return 0;
+}
+
+static inline auto appendHistory(const std::string &scenario, const std::filesystem::path &run_dir, const std::string &line) -> void {
+    std::ofstream history(getBaselineDir(scenario) / HISTORY_FILE, std::ios::app);
+    if (!history.is_open()) {
+        std::cerr << "Can't open history of " << scenario << std::endl;
+        return;
+    }
+    history << run_dir.parent_path().filename().string() << "|" << line << std::endl;
+}
+
+/**
+ * compare the publish and subscribe samples of the run with the baseline of the scenario
+ * the first run of a scenario becomes its baseline
+ * @return true on regression
+ */
+static inline auto compareWithBaseline(const std::string &scenario, const std::filesystem::path &run_dir) -> bool {
+    auto baseline_dir = getBaselineDir(scenario);
+    auto base_sub = readScenarioSamples(baseline_dir, SUB_SAMPLES_PREFIX);
+    auto base_pub = readScenarioSamples(baseline_dir, PUB_SAMPLES_PREFIX);
+    if (base_sub.empty() && base_pub.empty()) {
+        spdlog::info("no baseline for {}, this run is the baseline", scenario);
+        saveBaseline(scenario, run_dir);
+        appendHistory(scenario, run_dir, "baseline");
+        return false;
+    }
+
+    std::string sub_summary {};
+    std::string pub_summary {};
+    auto sub_regression = compareDistribution(scenario + " subscribe", base_sub, readScenarioSamples(run_dir, SUB_SAMPLES_PREFIX), sub_summary);
+    auto pub_regression = compareDistribution(scenario + " publish", base_pub, readScenarioSamples(run_dir, PUB_SAMPLES_PREFIX), pub_summary);
+    appendHistory(scenario, run_dir, sub_summary + "|" + pub_summary);
+    return sub_regression || pub_regression;
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_COMPARE_H
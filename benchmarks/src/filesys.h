@@ -111,7 +111,15 @@ static auto inline remove_directory(const std::filesystem::path&  dir) {
     return 0;
 }
 
+/**
+ * the directory the results are written to, WORKING_DIR when it is set
+ * otherwise the latest directory under ./benchmarks (the children of run_tests get it from the test plan)
+ */
 static auto inline getWorkingDir() {
+    const char* working_dir = std::getenv("WORKING_DIR");
+    if (working_dir != nullptr) {
+        return std::filesystem::path(working_dir);
+    }
     auto dir_path = std::filesystem::current_path() / "benchmarks";
     auto dirs = getDirectories(dir_path);
     sort(dirs.begin(), dirs.end());
@@ -161,6 +169,42 @@ static auto inline writeVecToFile(const std::filesystem::path& file_name, std::v
     return 0;
 }
 
+/**
+ * write the whole content to a temporary file in the same directory and rename it,
+ * a reader sees the old file or the complete new one
+ */
+static auto inline writeFileAtomic(const std::filesystem::path& file_name, const std::string &content) -> int {
+    auto tmp_name = file_name;
+    tmp_name += ".tmp";
+    int fd = open(tmp_name.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        std::cerr << "Can't open file " << tmp_name << std::endl;
+        return -1;
+    }
+    size_t written = 0;
+    while (written < content.size()) {
+        auto res = ::write(fd, content.data() + written, content.size() - written);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Can't write file " << tmp_name << " : " << strerror(errno) << std::endl;
+            close(fd);
+            unlink(tmp_name.string().c_str());
+            return -1;
+        }
+        written += res;
+    }
+    fsync(fd);
+    close(fd);
+    if (rename(tmp_name.string().c_str(), file_name.string().c_str()) != 0) {
+        std::cerr << "Can't rename " << tmp_name << " to " << file_name << " : " << strerror(errno) << std::endl;
+        unlink(tmp_name.string().c_str());
+        return -1;
+    }
+    return 0;
+}
+
 static auto inline readFileToVec(const std::filesystem::path& file_name, std::vector<double> &vec) {
     std::ifstream input_file(file_name);
     if (!input_file) {
@@ -181,5 +225,41 @@ static auto inline readFileToVec(const std::filesystem::path& file_name, std::ve
     return 0;
 }
 
+/**
+ * readFileToVec for big files, one read of the whole file and strtod instead of a stream per line
+ */
+static auto inline readFileToVecFast(const std::filesystem::path& file_name, std::vector<double> &vec) -> int {
+    std::ifstream input_file(file_name, std::ios::binary | std::ios::ate);
+    if (!input_file) {
+        std::cerr << "Error open file for read : "  << file_name << std::endl;
+        return -1;
+    }
+    std::string data(static_cast<size_t>(input_file.tellg()), '\0');
+    input_file.seekg(0);
+    input_file.read(data.data(), data.size());
+    vec.reserve(vec.size() + data.size() / 12); // "0.000012345\n"
+    
+    const char *ptr = data.c_str();
+    const char *end = ptr + data.size();
+    while (ptr < end) {
+        char *next;
+        double val = std::strtod(ptr, &next);
+        if (next != ptr) {
+            vec.push_back(val);
+            ptr = next;
+            continue;
+        }
+        auto eol = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+        if (eol == nullptr) {
+            eol = end;
+        }
+        std::string line(ptr, eol);
+        if (line.find_first_not_of(" \t\r") != std::string::npos) {
+            std::cerr << "error invalid value (not double) : " << line << std::endl;
+        }
+        ptr = eol + 1;
+    }
+    return 0;
+}
 
 #endif //UP_ZENOH_EXAMPLE_CPP_FILESYS_H
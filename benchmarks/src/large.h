@@ -0,0 +1,311 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_LARGE_H
+#define UP_ZENOH_EXAMPLE_CPP_LARGE_H
+
+#include "utils.h"
+#include "buffer_pool.h"
+#include "report.h"
+#include <atomic>
+#include <mutex>
+#include <spdlog/spdlog.h>
+
+using namespace uprotocol::utransport;
+using namespace uprotocol::uri;
+using namespace uprotocol::uuid;
+using namespace uprotocol::v1;
+
+constexpr size_t LARGE_MIN_SIZE = 64 * 1024;
+constexpr size_t LARGE_MAX_SIZE = 8 * 1024 * 1024;
+constexpr int LARGE_NUMBER_OF_LOOPS = 50;
+constexpr int LARGE_POOL_BUFFERS = 4;
+constexpr double LARGE_TIMEOUT = 2.0;
+constexpr double LARGE_ASSUMED_TRANSPORT_COPIES = 1.0; // the copy into the zenoh buffer, not measured
+const std::string LARGE_PIPE = "[\"unixpipe/large.pipe\"]";
+
+/**
+ * binary header in the beginning of every large message
+ * kind 0 is a probe that is sent until the route to the subscriber exists
+ */
+struct large_header {
+    struct timespec sent;
+    uint32_t seq;
+    uint32_t kind;
+};
+
+class LargeSession : public  ZenohUTransport {
+public:
+    LargeSession(ZenohSessionManagerConfig &config) : ZenohUTransport(config) {}
+    ~LargeSession() {}
+
+    inline auto getSuccess() -> uprotocol::v1::UStatus {
+        return uSuccess_;
+    }
+};
+
+class LargeListener : public UListener {
+public:
+    UStatus onReceive(UMessage &umsg) override {
+        struct timespec tm{};
+        clock_gettime(CLOCK_MONOTONIC, &tm);
+        UStatus status;
+        auto payload = umsg.payload();
+        if (payload.isEmpty() || payload.size() < sizeof(large_header)) {
+            status.set_code(UCode::INVALID_ARGUMENT);
+            return status;
+        }
+        large_header header {};
+        std::memcpy(&header, payload.data(), sizeof(header));
+        if (header.kind == 0) {
+            probe_seen.store(true);
+            status.set_code(UCode::OK);
+            return status;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            duration_vec.push_back(getDuration(tm, header.sent));
+            last_rx = tm;
+        }
+        bytes.fetch_add(payload.size());
+        received.fetch_add(1);
+        status.set_code(UCode::OK);
+        return status;
+    }
+
+    auto reset() -> void {
+        std::lock_guard<std::mutex> lock(mutex_);
+        duration_vec.clear();
+        last_rx = {};
+        bytes.store(0);
+        received.store(0);
+    }
+
+    auto getDurations() -> std::vector<double> {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return duration_vec;
+    }
+
+    auto getLastRx() -> struct timespec {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_rx;
+    }
+
+    std::atomic<bool> probe_seen {false};
+    std::atomic<long> bytes {0};
+    std::atomic<int> received {0};
+
+private:
+    std::mutex mutex_;
+    std::vector<double> duration_vec {};
+    struct timespec last_rx {};
+};
+
+static inline auto sizeName(size_t size) -> std::string {
+    if (size >= 1024 * 1024 && size % (1024 * 1024) == 0) {
+        return std::to_string(size / (1024 * 1024)) + "M";
+    }
+    if (size >= 1024 && size % 1024 == 0) {
+        return std::to_string(size / 1024) + "K";
+    }
+    return std::to_string(size);
+}
+
+static inline auto sendLarge(LargeSession *session, const UUri &uri, uint8_t *buffer, size_t size, UPayloadType type, size_t &copies) -> UStatus {
+    auto uuid = Uuidv8Factory::create();
+    UAttributesBuilder builder(uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
+    UAttributes attributes = builder.build();
+    UPayload payload(buffer, size, type);
+    // VALUE copies the buffer into the payload, REFERENCE keeps the pointer to the pool buffer
+    if (payload.data() != buffer) {
+        copies++;
+    }
+    UMessage umsg(payload, attributes);
+    return session->send(umsg);
+}
+
+/**
+ * sweep the payload size from min_size to max_size (x2 every step) and compare the
+ * UPayloadType::VALUE path with UPayloadType::REFERENCE payloads backed by the registered BufferPool
+ * both sessions are in this process, the subscriber listens on a unixpipe and the publisher connects to it
+ * copies per message are the payload copies done before send() (measured), the copy the transport does into
+ * the zenoh buffer is not measured and is reported apart as assumed_transport_copies
+ */
+auto large(int loops, size_t min_size, size_t max_size, Report &report) -> int {
+    min_size = std::max(min_size, sizeof(large_header));
+    max_size = std::max(max_size, min_size);
+
+    ZenohSessionManagerConfig sub_config{};
+    sub_config.listenKey = LARGE_PIPE;
+    sub_config.connectKey = "";
+    sub_config.qosEnabled = "false";
+    sub_config.lowLatency = "false"; // lowLatency does not support fragmentation of large messages
+    sub_config.scouting_delay = 0;
+
+    ZenohSessionManagerConfig pub_config = sub_config;
+    pub_config.listenKey = "";
+    pub_config.connectKey = LARGE_PIPE;
+
+    auto *sub = new LargeSession(sub_config);
+    if (UCode::OK != sub->getSuccess().code()) {
+        spdlog::error("ZenohUTransport init failed");
+        return -1;
+    }
+    auto *pub = new LargeSession(pub_config);
+    if (UCode::OK != pub->getSuccess().code()) {
+        spdlog::error("ZenohUTransport init failed");
+        delete sub;
+        return -1;
+    }
+
+    auto u_authority = BuildUAuthority().build();
+    auto u_entity = BuildUEntity().setId(200).setMajorVersion(1).build();
+    auto u_resource = BuildUResource().setID(200 << 3).build();
+    auto uri = BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
+
+    LargeListener listener {};
+    auto status = sub->registerListener(uri, listener);
+    if (UCode::OK != status.code()) {
+        spdlog::error("registerListener failed");
+        delete pub;
+        delete sub;
+        return -1;
+    }
+
+    BufferPool pool(LARGE_POOL_BUFFERS, max_size);
+    if (pool.size() == 0) {
+        spdlog::error("Failed to allocate the buffer pool, {}", strerror(errno));
+        delete pub;
+        delete sub;
+        return -1;
+    }
+    // the content does not change between messages, only the header does
+    pool.forEach([](uint8_t *buffer, size_t size) {
+        fillbufferWithRandom(buffer, 0, size);
+    });
+    spdlog::info("buffer pool : {} buffers of {} bytes, locked {}", pool.size(), pool.bufferSize(), pool.isLocked());
+
+    // messages that are sent before the route to the subscriber exists are lost
+    struct timespec start{};
+    struct timespec end{};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t copies = 0;
+    while (!listener.probe_seen.load()) {
+        auto buffer = pool.acquire();
+        large_header header {};
+        std::memcpy(buffer, &header, sizeof(header));
+        sendLarge(pub, uri, buffer, sizeof(header), UPayloadType::VALUE, copies);
+        pool.release(buffer);
+        usleep(100);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (getDuration(end, start) > LARGE_TIMEOUT) {
+            spdlog::error("no connection to the subscriber after {} seconds", LARGE_TIMEOUT);
+            sub->unregisterListener(uri, listener);
+            delete pub;
+            delete sub;
+            return -1;
+        }
+    }
+
+    std::vector<std::string> summary {};
+    spdlog::info("{}", printHeader());
+    for (auto size = min_size; size <= max_size; size *= 2) {
+        for (auto type : {UPayloadType::VALUE, UPayloadType::REFERENCE}) {
+            std::string name = (type == UPayloadType::VALUE ? "V " : "R ") + sizeName(size);
+            std::vector<double> send_vec {};
+            listener.reset();
+            copies = 0;
+            struct timespec first{};
+            clock_gettime(CLOCK_MONOTONIC, &first);
+            for (auto i = 0; i < loops && !terminate; i++) {
+                auto buffer = pool.acquire();
+                large_header header {};
+                header.seq = i;
+                header.kind = 1;
+                clock_gettime(CLOCK_MONOTONIC, &header.sent);
+                std::memcpy(buffer, &header, sizeof(header));
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                status = sendLarge(pub, uri, buffer, size, type, copies);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                pool.release(buffer);
+                if (UCode::OK != status.code()) {
+                    spdlog::error("send.send failed for {}", name);
+                    break;
+                }
+                send_vec.push_back(getDuration(end, start));
+            }
+
+            // wait for the last messages
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            while (listener.received.load() < static_cast<int>(send_vec.size())) {
+                usleep(100);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                if (getDuration(end, start) > LARGE_TIMEOUT) {
+                    break;
+                }
+            }
+
+            auto durations = listener.getDurations();
+            auto last_rx = listener.getLastRx();
+            auto received = listener.received.load();
+            auto elapsed = getDuration(last_rx, first);
+            double bandwidth = (received > 0 && elapsed > 0) ? listener.bytes.load() / elapsed / (1024.0 * 1024.0) : 0.0;
+            double copies_per_msg = send_vec.empty() ? 0.0 : static_cast<double>(copies) / send_vec.size();
+
+            auto sent = send_vec.size();
+            auto send_stat = getStats(send_vec);
+            auto latency_stat = getStats(durations);
+            if (send_stat.has_value()) {
+                spdlog::info("{}", printStat("s" + name, send_stat.value()));
+            }
+            if (latency_stat.has_value()) {
+                spdlog::info("{}", printStat("l" + name, latency_stat.value()));
+            }
+            report.add("send " + name, send_stat, sent);
+            auto row = makeReportRow("latency " + name, latency_stat, durations.size());
+            row.throughput = elapsed > 0 ? std::make_optional(received / elapsed) : std::nullopt;
+            row.lost = static_cast<long>(sent) - received;
+            row.extra.emplace_back("size", size);
+            row.extra.emplace_back("mb_per_s", bandwidth);
+            row.extra.emplace_back("copies_per_message", copies_per_msg);
+            row.extra.emplace_back("assumed_transport_copies", LARGE_ASSUMED_TRANSPORT_COPIES);
+            report.add(row);
+            std::stringstream s;
+            s << std::fixed << std::setprecision(2) << name << " : " << bandwidth << " MB/s, received "
+              << received << "/" << send_vec.size() << ", " << copies_per_msg << " copies per message before send()";
+            summary.push_back(s.str());
+        }
+    }
+    for (auto const &line : summary) {
+        spdlog::info("{}", line);
+    }
+
+    sub->unregisterListener(uri, listener);
+    delete pub;
+    delete sub;
+    return 0;
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_LARGE_H
@@ -26,6 +26,10 @@
 #include "utils.h"
 #include "sub.h"
 #include "pub.h"
+#include "large.h"
+#include "qos.h"
+#include "replay.h"
+#include "report.h"
 
 #include <spdlog/spdlog.h>
 
@@ -38,6 +42,103 @@ auto main(const int argc, char **argv) -> int {
     int message_size = MESSAGE_SIZE;
     int max_uri = NUMBER_OF_MAX_URI;
     
+    // benc churn [number of uri] [interleaved operations]
+    if (argc >= 2 && std::string("churn") == argv[1]) {
+        int churn_uri = CHURN_NUMBER_OF_URI;
+        char *endptr;
+        if (argc >= 3) {
+            churn_uri = std::strtol(argv[2], &endptr, 10);
+        }
+        int churn_ops = churn_uri;
+        if (argc >= 4) {
+            churn_ops = std::strtol(argv[3], &endptr, 10);
+        }
+        Report report("benc churn");
+        auto res = sub_churn(churn_uri, churn_ops, report);
+        report.write(getReportDir());
+        return res;
+    }
+    
+    // benc large [loops] [min size] [max size]
+    if (argc >= 2 && std::string("large") == argv[1]) {
+        int large_loops = LARGE_NUMBER_OF_LOOPS;
+        size_t min_size = LARGE_MIN_SIZE;
+        size_t max_size = LARGE_MAX_SIZE;
+        char *endptr;
+        if (argc >= 3) {
+            large_loops = std::strtol(argv[2], &endptr, 10);
+        }
+        if (argc >= 4) {
+            min_size = std::strtoul(argv[3], &endptr, 10);
+        }
+        if (argc >= 5) {
+            max_size = std::strtoul(argv[4], &endptr, 10);
+        }
+        Report report("benc large");
+        auto res = large(large_loops, min_size, max_size, report);
+        report.write(getReportDir());
+        return res;
+    }
+    
+    // benc qos [seconds] [bulk size] [priority period us]
+    if (argc >= 2 && std::string("qos") == argv[1]) {
+        int duration = QOS_DURATION;
+        size_t bulk_size = QOS_BULK_SIZE;
+        long period_us = QOS_PRIORITY_PERIOD_US;
+        char *endptr;
+        if (argc >= 3) {
+            duration = std::strtol(argv[2], &endptr, 10);
+        }
+        if (argc >= 4) {
+            bulk_size = std::strtoul(argv[3], &endptr, 10);
+        }
+        if (argc >= 5) {
+            period_us = std::strtol(argv[4], &endptr, 10);
+        }
+        Report report("benc qos");
+        auto res = qos(duration, bulk_size, period_us, report);
+        report.write(getReportDir());
+        return res;
+    }
+    
+    // benc record <file> [seconds] [endpoint] [entity:resource,...]
+    if (argc >= 3 && std::string("record") == argv[1]) {
+        int duration = RECORD_DURATION;
+        std::string endpoint = DEFAULT_ENDPOINT;
+        std::string topics = RECORD_TOPICS;
+        char *endptr;
+        if (argc >= 4) {
+            duration = std::strtol(argv[3], &endptr, 10);
+        }
+        if (argc >= 5) {
+            endpoint = argv[4];
+        }
+        if (argc >= 6) {
+            topics = argv[5];
+        }
+        Report report("benc record");
+        auto res = record(argv[2], duration, endpoint, topics, report);
+        report.write(getReportDir());
+        return res;
+    }
+    
+    // benc replay <file> [speed, 0 is as fast as possible] [endpoint]
+    if (argc >= 3 && std::string("replay") == argv[1]) {
+        double speed = 1.0;
+        std::string endpoint {};
+        char *endptr;
+        if (argc >= 4) {
+            speed = std::strtod(argv[3], &endptr);
+        }
+        if (argc >= 5) {
+            endpoint = argv[4];
+        }
+        Report report("benc replay");
+        auto res = replay(argv[2], speed, endpoint, report);
+        report.write(getReportDir());
+        return res;
+    }
+    
     if (argc >= 2) {
         char *endptr;
         loops = std::strtol(argv[1], &endptr, 10);
@@ -52,8 +153,10 @@ auto main(const int argc, char **argv) -> int {
     }
     
     
-    sub(loops, max_uri);
-    pub(loops, message_size, max_uri);
+    Report report("benc");
+    sub(loops, max_uri, report);
+    pub(loops, message_size, max_uri, report);
+    report.write(getReportDir());
 }
 
 
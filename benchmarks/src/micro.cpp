@@ -0,0 +1,406 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#include "utils.h"
+#include "report.h"
+#include "MessageBuilder.h"
+#include "LatestValueCache.h"
+#include "UuidPool.h"
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <spdlog/spdlog.h>
+
+using namespace uprotocol::utransport;
+using namespace uprotocol::uri;
+using namespace uprotocol::uuid;
+using namespace uprotocol::v1;
+
+constexpr int MICRO_REPETITIONS = 30;
+constexpr double MICRO_WARMUP_SECONDS = 0.2;
+constexpr double MICRO_MIN_BATCH_SECONDS = 0.001; // a batch is long enough to hide the clock_gettime cost
+constexpr size_t MICRO_MAX_BATCH = 1 << 22;
+
+/**
+ * every operator new is counted on its thread, operator new[] and the nothrow versions end up here too.
+ * runMicro reads the counters of the measuring thread so the threads of a Contention benchmark are not
+ * charged to the measured operation and counting never touches a shared cache line
+ */
+static thread_local size_t micro_allocations __attribute__((tls_model("initial-exec"))) = 0;
+static thread_local size_t micro_allocated_bytes __attribute__((tls_model("initial-exec"))) = 0;
+
+auto operator new(size_t size) -> void* {
+    micro_allocations++;
+    micro_allocated_bytes += size;
+    if (auto ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator delete(void *ptr) noexcept -> void {
+    std::free(ptr);
+}
+
+auto operator delete(void *ptr, size_t) noexcept -> void {
+    std::free(ptr);
+}
+
+/**
+ * keep the compiler from removing the result of the measured operation
+ */
+template<typename T>
+static inline auto doNotOptimize(const T &value) -> void {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct micro_result {
+    std::string name;
+    std::vector<double> ns_per_op;
+    size_t rejected;
+    size_t ops;
+    double allocs_per_op;
+    double bytes_per_op;
+};
+
+/**
+ * Tukey fences, drop the repetitions outside [Q1 - 1.5 IQR, Q3 + 1.5 IQR]
+ * (preemption, page faults, frequency changes)
+ */
+static inline auto rejectOutliers(std::vector<double> &vec) -> size_t {
+    if (vec.size() < 4) {
+        return 0;
+    }
+    std::sort(vec.begin(), vec.end());
+    auto q1 = getPercentileFromSortedVec(vec, 25).value();
+    auto q3 = getPercentileFromSortedVec(vec, 75).value();
+    auto iqr = q3 - q1;
+    auto size = vec.size();
+    vec.erase(std::remove_if(vec.begin(), vec.end(), [=](double e) {
+        return e < q1 - 1.5 * iqr || e > q3 + 1.5 * iqr;
+    }), vec.end());
+    return size - vec.size();
+}
+
+/**
+ * warm up func and find the batch size that runs for at least MICRO_MIN_BATCH_SECONDS,
+ * then time repetitions batches and report the time and the allocations per operation
+ */
+template<typename F>
+static inline auto runMicro(const std::string &name, int repetitions, F &&func) -> micro_result {
+    struct timespec start{};
+    struct timespec end{};
+    size_t batch = 1;
+    struct timespec warmup_start{};
+    clock_gettime(CLOCK_MONOTONIC, &warmup_start);
+    while (true) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t i = 0; i < batch; i++) {
+            func();
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (getDuration(end, start) < MICRO_MIN_BATCH_SECONDS && batch < MICRO_MAX_BATCH) {
+            batch *= 2;
+            continue;
+        }
+        if (getDuration(end, warmup_start) >= MICRO_WARMUP_SECONDS) {
+            break;
+        }
+    }
+
+    micro_result result {};
+    result.name = name;
+    size_t allocations = 0;
+    size_t bytes = 0;
+    for (auto r = 0; r < repetitions && !terminate; r++) {
+        auto allocations_before = micro_allocations;
+        auto bytes_before = micro_allocated_bytes;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t i = 0; i < batch; i++) {
+            func();
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        allocations += micro_allocations - allocations_before;
+        bytes += micro_allocated_bytes - bytes_before;
+        result.ns_per_op.push_back(getDuration(end, start) * 1.0e9 / batch);
+        result.ops += batch;
+    }
+    result.rejected = rejectOutliers(result.ns_per_op);
+    result.allocs_per_op = result.ops > 0 ? static_cast<double>(allocations) / result.ops : 0.0;
+    result.bytes_per_op = result.ops > 0 ? static_cast<double>(bytes) / result.ops : 0.0;
+    return result;
+}
+
+/**
+ * threads that run func in a loop while a benchmark is timed on the main thread
+ */
+class Contention {
+public:
+    template<typename F>
+    Contention(size_t threads, F &&func) {
+        for (size_t i = 0; i < threads; i++) {
+            threads_.emplace_back([this, func]() {
+                while (running_.load(std::memory_order_relaxed)) {
+                    func();
+                }
+            });
+        }
+    }
+
+    ~Contention() {
+        running_.store(false);
+        for (auto &thread : threads_) {
+            thread.join();
+        }
+    }
+
+private:
+    std::atomic<bool> running_ {true};
+    std::vector<std::thread> threads_ {};
+};
+
+/**
+ * the building blocks of a published message, one at a time
+ * filter runs only the benchmarks whose name contains it
+ */
+auto micro(int repetitions, int msg_size, const std::string &filter, Report &report) -> int {
+    auto u_authority = BuildUAuthority().build();
+    auto u_entity = BuildUEntity().setName("test.app").setId(1).setMajorVersion(1).build();
+    auto u_resource = BuildUResource().setName("dummy").setID(1 << 3).build();
+    auto uri = BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
+
+    auto micro_uri = MicroUriSerializer::serialize(uri);
+    auto long_uri = LongUriSerializer::serialize(uri);
+    auto hex_uri = convertSerializedURItoString(micro_uri);
+    auto uuid = Uuidv8Factory::create();
+    UAttributesBuilder builder(uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
+    auto attributes = builder.build();
+    std::vector<uint8_t> buffer(msg_size);
+    fillbufferWithRandom(buffer.data(), 0, buffer.size());
+
+    std::vector<micro_result> results {};
+    auto wanted = [&](const std::string &name) {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    };
+    auto run = [&](const std::string &name, auto &&func) {
+        if (!wanted(name)) {
+            return;
+        }
+        results.push_back(runMicro(name, repetitions, func));
+    };
+
+    run("noop", [&]() {
+        doNotOptimize(uri);
+    });
+    run("micro serialize", [&]() {
+        doNotOptimize(MicroUriSerializer::serialize(uri));
+    });
+    run("micro deserialize", [&]() {
+        doNotOptimize(MicroUriSerializer::deserialize(micro_uri));
+    });
+    run("long serialize", [&]() {
+        doNotOptimize(LongUriSerializer::serialize(uri));
+    });
+    run("long deserialize", [&]() {
+        doNotOptimize(LongUriSerializer::deserialize(long_uri));
+    });
+    run("uri to hex", [&]() {
+        doNotOptimize(convertSerializedURItoString(micro_uri));
+    });
+    run("hex to uri", [&]() {
+        doNotOptimize(convertHexStringToUint8Vec(hex_uri));
+    });
+    run("uuid create", [&]() {
+        doNotOptimize(Uuidv8Factory::create());
+    });
+    // the ids of a thread from batches reserved ahead (UuidPool.h), alone and next to threads that create ids
+    run("uuid pool", [&]() {
+        doNotOptimize(UuidPool::local().next());
+    });
+    constexpr size_t UUID_THREADS = 3;
+    if (wanted("uuid create, threads")) {
+        Contention others(UUID_THREADS, []() {
+            doNotOptimize(Uuidv8Factory::create());
+        });
+        run("uuid create, threads", [&]() {
+            doNotOptimize(Uuidv8Factory::create());
+        });
+    }
+    if (wanted("uuid pool, threads")) {
+        Contention others(UUID_THREADS, []() {
+            doNotOptimize(UuidPool::local().next());
+        });
+        run("uuid pool, threads", [&]() {
+            doNotOptimize(UuidPool::local().next());
+        });
+    }
+    run("attributes build", [&]() {
+        UAttributesBuilder attributes_builder(uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
+        doNotOptimize(attributes_builder.build());
+    });
+    run("umessage", [&]() {
+        UPayload payload(buffer.data(), buffer.size(), UPayloadType::VALUE);
+        UMessage umsg(payload, attributes);
+        doNotOptimize(umsg);
+    });
+    // everything pub() does before send()
+    run("message", [&]() {
+        auto message_uuid = Uuidv8Factory::create();
+        UAttributesBuilder attributes_builder(uri, message_uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
+        UPayload payload(buffer.data(), buffer.size(), UPayloadType::VALUE);
+        UMessage umsg(payload, attributes_builder.build());
+        doNotOptimize(umsg);
+    });
+    // the same message with the attributes of the topic built once (ReusableAttributes) or on an arena
+    ReusableAttributes reusable(uri);
+    run("message reuse", [&]() {
+        UPayload payload(buffer.data(), buffer.size(), UPayloadType::VALUE);
+        UMessage umsg(payload, reusable.next());
+        doNotOptimize(umsg);
+    });
+    run("message reuse create", [&]() {
+        UPayload payload(buffer.data(), buffer.size(), UPayloadType::VALUE);
+        UMessage umsg(payload, reusable.next(Uuidv8Factory::create()));
+        doNotOptimize(umsg);
+    });
+    ArenaAttributes arena(uri);
+    run("message arena", [&]() {
+        UPayload payload(buffer.data(), buffer.size(), UPayloadType::VALUE);
+        UMessage umsg(payload, arena.next());
+        doNotOptimize(umsg);
+    });
+    // the receive side, a copy of the attributes against a reference
+    UPayload received_payload(buffer.data(), buffer.size(), UPayloadType::VALUE);
+    UMessage received(received_payload, attributes);
+    run("receive copy", [&]() {
+        auto received_attributes = received.attributes();
+        auto source = received_attributes.source();
+        doNotOptimize(source);
+    });
+    run("receive ref", [&]() {
+        const auto &received_attributes = received.attributes();
+        const auto &source = received_attributes.source();
+        doNotOptimize(source);
+    });
+
+    // the latest value cache (seqlock) alone and with readers and a writer on other threads, against a mutex
+    constexpr size_t LATEST_READERS = 3;
+    LatestValueCache cache(1);
+    auto latest_index = cache.add(1).value();
+    uint64_t latest_counter = 0;
+    std::mutex latest_mutex {};
+    uint64_t latest_locked = 0;
+    auto latest_write = [&]() {
+        latest_counter++;
+        cache.write(latest_index, reinterpret_cast<const uint8_t *>(&latest_counter), sizeof(latest_counter));
+    };
+    auto latest_read = [&]() {
+        uint64_t value = 0;
+        doNotOptimize(cache.read(latest_index, value));
+        doNotOptimize(value);
+    };
+    latest_write();
+    run("latest read", latest_read);
+    run("latest write", latest_write);
+    // the threads are only started for the benchmarks that run
+    if (wanted("latest read, writer")) {
+        Contention writer(1, [&cache, latest_index]() {
+            static thread_local uint64_t counter = 0;
+            counter++;
+            cache.write(latest_index, reinterpret_cast<const uint8_t *>(&counter), sizeof(counter));
+        });
+        run("latest read, writer", latest_read);
+    }
+    if (wanted("latest write, readers") || wanted("latest read, readers")) {
+        Contention readers(LATEST_READERS, [&cache, latest_index]() {
+            uint64_t value = 0;
+            doNotOptimize(cache.read(latest_index, value));
+        });
+        run("latest write, readers", latest_write);
+        run("latest read, readers", latest_read);
+    }
+    auto locked_read = [&]() {
+        std::lock_guard<std::mutex> lock(latest_mutex);
+        doNotOptimize(latest_locked);
+    };
+    run("mutex read", locked_read);
+    if (wanted("mutex read, writer")) {
+        Contention writer(1, [&latest_mutex, &latest_locked]() {
+            std::lock_guard<std::mutex> lock(latest_mutex);
+            latest_locked++;
+        });
+        run("mutex read, writer", locked_read);
+    }
+
+    spdlog::info("{} repetitions, message size {}, values in ns per operation", repetitions, msg_size);
+    spdlog::info("{}", printHeader());
+    for (auto &result : results) {
+        auto count = result.ns_per_op.size();
+        auto stat = getStats(result.ns_per_op);
+        if (stat.has_value()) {
+            spdlog::info("{}", printStat(result.name, stat.value()));
+        }
+        auto row = makeReportRow(result.name, stat, count);
+        row.extra.emplace_back("ops", result.ops);
+        row.extra.emplace_back("rejected", result.rejected);
+        row.extra.emplace_back("allocs_per_op", result.allocs_per_op);
+        row.extra.emplace_back("bytes_per_op", result.bytes_per_op);
+        report.add(row);
+    }
+    for (auto &result : results) {
+        auto median = getMedianSorted(result.ns_per_op);
+        spdlog::info("{} : {:.1f} ns/op, {:.2f} allocs/op, {:.0f} bytes/op, {} of {} repetitions rejected",
+                     result.name, median.value_or(0.0), result.allocs_per_op, result.bytes_per_op,
+                     result.rejected, result.rejected + result.ns_per_op.size());
+    }
+    return 0;
+}
+
+auto main(const int argc, char **argv) -> int {
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+    std::signal(SIGABRT, signalHandler);
+
+    // micro [repetitions] [message size] [filter]
+    int repetitions = MICRO_REPETITIONS;
+    int message_size = MESSAGE_SIZE;
+    std::string filter {};
+    char *endptr;
+    if (argc >= 2) {
+        repetitions = std::strtol(argv[1], &endptr, 10);
+    }
+    if (argc >= 3) {
+        message_size = std::strtol(argv[2], &endptr, 10);
+    }
+    if (argc >= 4) {
+        filter = argv[3];
+    }
+
+    Report report("micro");
+    auto res = micro(repetitions, message_size, filter, report);
+    report.write(getReportDir());
+    return res;
+}
@@ -28,6 +28,9 @@
 #define UP_ZENOH_EXAMPLE_CPP_PUB_H
 #include "utils.h"
 #include "filesys.h"
+#include "report.h"
+#include "stages.h"
+#include "MessageBuilder.h"
 #include <spdlog/spdlog.h>
 
 using namespace uprotocol::utransport;
@@ -49,7 +52,7 @@ public :
     
 };
 
-auto pub(const int loops, int msg_size, int num_of_uri) -> int {
+auto pub(const int loops, int msg_size, int num_of_uri, Report &report) -> int {
     std::vector<UUri> uri_vec {};
     for (auto i = 0; i < num_of_uri; i++) {
         auto u_authority = BuildUAuthority().build();
@@ -69,34 +72,46 @@ auto pub(const int loops, int msg_size, int num_of_uri) -> int {
         return -1;
     }
     
+    // the attributes of every uri are built once, a message only gets a new id
+    std::vector<ReusableAttributes> attributes_vec {};
+    for (auto const& uri : uri_vec) {
+        attributes_vec.emplace_back(uri);
+    }
+    
+    // every stage of a message is timed, send alone is the "publish" row
+    StageTimer stages(static_cast<size_t>(loops) * attributes_vec.size());
     std::vector<double> pub_vec {};
     for (auto i = 0; i < loops; i++) {
         std::stringstream s;
-        for (auto const& uri : uri_vec) {
+        for (auto &attributes : attributes_vec) {
             struct timespec tm{};
             struct timespec start{};
             struct timespec end{};
             clock_gettime(CLOCK_MONOTONIC, &tm);
+            stages.start(tm);
             s << std::fixed << std::setprecision(9) << tm.tv_sec << "." << tm.tv_nsec << "|" << i << "|";
             auto len = s.str().size();
             if (msg_size - len > 0) {
                 s << generateRandomString(msg_size - len);
             }
-            auto uuid = Uuidv8Factory::create();
-            UAttributesBuilder builder(uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
-            UAttributes attributes = builder.build();
-    
             UPayload payload((const uint8_t *)(s.str().c_str()), msg_size, UPayloadType::VALUE);
-    
-            UMessage umsg(payload, attributes);
+            stages.mark(STAGE_PAYLOAD);
+            auto id = UuidPool::local().next();
+            stages.mark(STAGE_UUID);
+            auto &message_attributes = attributes.next(id);
+            stages.mark(STAGE_ATTRIBUTES);
+            UMessage umsg(payload, message_attributes);
     
             clock_gettime(CLOCK_MONOTONIC, &start);
+            stages.mark(STAGE_UMESSAGE, start);
             UStatus status = transport->send(umsg);
             if (UCode::OK != status.code()) {
                 spdlog::error("send.send failed");
                 return UCode::UNAVAILABLE;
             }
             clock_gettime(CLOCK_MONOTONIC, &end);
+            stages.mark(STAGE_SEND, end);
+            stages.finish(i != 0);
             if (i != 0) {
                 pub_vec.push_back(getDuration(end, start));
             }
@@ -105,8 +120,18 @@ auto pub(const int loops, int msg_size, int num_of_uri) -> int {
     }
     delete transport;
     
+    auto count = pub_vec.size();
     auto pub_stat = getStats(pub_vec);
-    spdlog::info("{}", printStat("publish", pub_stat.value()));
+    if (pub_stat.has_value()) {
+        spdlog::info("{}", printStat("publish", pub_stat.value()));
+    }
+    auto row = makeReportRow("publish", pub_stat, count);
+    row.extra.emplace_back("message_size", msg_size);
+    report.add(row);
+    // where the time of a message goes, the application side (payload to umessage) against the transport (send)
+    auto stage_stats = stages.stats();
+    printStages("publish", stage_stats);
+    addStagesToReport(report, "publish", stages.samples(), stage_stats);
     
     return 0;
 }
@@ -25,6 +25,13 @@
 
 #include "utils.h"
 #include "filesys.h"
+#include "test_plan.h"
+#include "window.h"
+#include "tail.h"
+#include "alloc_trace.h"
+#include "stages.h"
+#include "MessageBuilder.h"
+#include "Trace.h"
 
 
 using namespace uprotocol::utransport;
@@ -32,13 +39,29 @@ using namespace uprotocol::uri;
 using namespace uprotocol::uuid;
 using namespace uprotocol::v1;
 
-struct my_uuri {
-    UUri uri;
+/**
+ * a topic of this publisher from the test plan
+ */
+struct pub_topic {
+    uint32_t entity_id;
+    uint32_t resource_id;
+    uint32_t message_size;
+    uint32_t period_us;
+    uint32_t sent;
+    struct timespec next;
+    ReusableAttributes attributes;
 };
 
-// need to support std::set
-bool operator<(const my_uuri& lhs, const my_uuri& rhs) {
-    return MicroUriSerializer::serialize(lhs.uri) < MicroUriSerializer::serialize(rhs.uri);
+static inline auto isBefore(const struct timespec &lhs, const struct timespec &rhs) -> bool {
+    return lhs.tv_sec < rhs.tv_sec || (lhs.tv_sec == rhs.tv_sec && lhs.tv_nsec < rhs.tv_nsec);
+}
+
+static inline auto addMicroseconds(struct timespec &tm, uint32_t us) -> void {
+    tm.tv_nsec += static_cast<long>(us) * 1000;
+    while (tm.tv_nsec >= 1000000000L) {
+        tm.tv_nsec -= 1000000000L;
+        tm.tv_sec++;
+    }
 }
 
 class Publisher : public  ZenohUTransport {
@@ -56,28 +79,37 @@ public :
         
 };
 
+// pub_test <app> <test plan>
 auto main(const int argc, char **argv) -> int {
 //    std::signal(SIGINT, signalHandler);
 //    std::signal(SIGTERM, signalHandler);
 //    std::signal(SIGABRT, signalHandler);
-//    auto num_messages = getEnvNumberOfMessages();
-//    auto p_id = getpid();
-    std::vector<std::string> uri_str = getUristr(argc, argv);
-    auto dir = getWorkingDir();
-    int msg_size = 200;
-    // select number of publishers out of the list will be elected for this run minimum is 2
-    //auto number_of_publishers = getRandomInRange(4, uri_str.size() - 1);
-    auto number_of_publishers = uri_str.size();
+    if (argc < 3) {
+        std::cout << "usage : " << argv[0] << " <app> <test plan>" << std::endl;
+        return -1;
+    }
+    TestPlan plan {};
+    if (plan.open(argv[2]) != 0) {
+        return -1;
+    }
+    auto app = plan.app(argv[1]);
+    if (app == nullptr || app->role != plan_role::PUBLISHER) {
+        spdlog::error("{} is not a publisher of the test plan", argv[1]);
+        return -1;
+    }
+    auto dir = plan.workingDir();
     std::string file_name = "pub-" + (std::string)argv[1];
-    auto path = dir / file_name;
-    //std::cout << path << std::endl;
+    if (Tracer::enabledByEnv()) {
+        Tracer::instance().enable();
+        Tracer::instance().nameThread("publish");
+    }
     
     std::vector<shm_data> shm_vec;
     if (createSheredMem((std::string(argv[0])), std::string(argv[1]), shm_vec) != 0) {
         spdlog::error("Failed to open shered memory, {}", strerror(errno));
         return -1;
     }
-    auto list_of_servers = createServerPortlist(MAX_PROCESS);
+    auto list_of_servers = createServerPortlist(plan.topology(), plan.locator());
     auto connect_key = getAllSubKeys(list_of_servers);
     
     ZenohSessionManagerConfig config{};
@@ -97,70 +129,134 @@ auto main(const int argc, char **argv) -> int {
         return -1;
     }
     
-    std::set<my_uuri> uri; // using of set to avoid duplicates
-    for (ulong i = 0; i < number_of_publishers; i++) {
-        my_uuri my_uri;
-        //auto str = uri_str[getRandomInRange(0, uri_str.size() - 1)];
-        auto str = uri_str[i];
-        auto vec = convertHexStringToUint8Vec(str);
-    
-        my_uri.uri = MicroUriSerializer::deserialize(vec);
-
-        uri.insert(my_uri);
-//        auto res = uri.insert(my_uri);
-//        if (!res.second) {
-//            str = uri_str[getRandomInRange(0, uri_str.size() - 1)];
-//            vec.clear();
-//            vec = convertHexStringToUint8Vec(str);
-//            my_uri.uri = MicroUriSerializer::deserialize(vec);
-//            uri.insert(my_uri);
-//        }
+    std::vector<pub_topic> topics {};
+    for (auto topic : plan.topics(*app)) {
+        topics.push_back({topic->entity_id, topic->resource_id, topic->message_size, topic->period_us, 0, {},
+                          ReusableAttributes(TestPlan::buildUri(*topic))});
     }
     
-    //open session
-    
-    //start publishing
-    std::vector<double> pub_vec {};
-    for (auto i = 0; i < 100000; i++) {
-        std::stringstream s;
-        for (auto const& u : uri) {
+    //start publishing, every topic is sent every period_us of the plan until it sent loops messages
+    auto loops = plan.header()->loops;
+    WindowSeries series(plan.header()->window_us * 1.0e-6);
+    series.reserve(static_cast<size_t>(loops) * topics.size());
+    TailRecorder tail(plan.header()->tail_threshold_us * 1.0e-6, plan.header()->tail_capacity);
+    struct timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (auto &topic : topics) {
+        topic.next = now;
+    }
+    size_t done = loops == 0 ? topics.size() : 0;
+    size_t send_errors = 0;
+    std::string data {};
+    // the allocations are counted after the first tenth of the sends, the start of the connections is not steady state
+    uint64_t total_sent = 0;
+    auto alloc_from = static_cast<uint64_t>(loops) * topics.size() / 10;
+    alloc_counters alloc_thread {};
+    alloc_counters alloc_start {};
+    // the stages of every message (stages.h), finish() drops the first send of a topic and the failed sends
+    StageTimer stages(static_cast<size_t>(loops) * topics.size());
+    while (done < topics.size()) {
+        struct timespec wake{};
+        bool has_wake = false;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (auto &topic : topics) {
+            if (topic.sent >= loops) {
+                continue;
+            }
+            if (isBefore(now, topic.next)) {
+                if (!has_wake || isBefore(topic.next, wake)) {
+                    wake = topic.next;
+                    has_wake = true;
+                }
+                continue;
+            }
             struct timespec tm{};
             struct timespec start{};
             struct timespec end{};
+            auto trace_id = traceMessageId(app->index, TestPlan::topicIndex(topic.entity_id, topic.resource_id), topic.sent);
+            TraceScope trace_message("message", trace_id);
             clock_gettime(CLOCK_MONOTONIC, &tm);
-            s << tm.tv_sec << "." << tm.tv_nsec << "|" << i << "|";
-            auto len = s.str().size();
-            if (msg_size - len > 0) {
-                s << generateRandomString(msg_size - len);
+            stages.start(tm);
+            std::stringstream s;
+            s << tm.tv_sec << "." << tm.tv_nsec << "|" << topic.sent << "|" << app->index << "|";
+            data = s.str();
+            // the payload is the string with its '\0' so the subscriber can parse it in place
+            if (data.size() + 1 < topic.message_size) {
+                data += generateRandomString(topic.message_size - data.size() - 1);
             }
-            auto uuid = Uuidv8Factory::create();
-             
-            UAttributesBuilder builder(u.uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
-            UAttributes attributes = builder.build();
-    
-            UPayload payload((const uint8_t *)(s.str().c_str()), msg_size, UPayloadType::VALUE);
-    
+            UPayload payload((const uint8_t *)(data.c_str()), data.size() + 1, UPayloadType::VALUE);
+            stages.mark(STAGE_PAYLOAD, trace_id);
+            auto id = UuidPool::local().next();
+            stages.mark(STAGE_UUID, trace_id);
+            auto &attributes = topic.attributes.next(id);
+            stages.mark(STAGE_ATTRIBUTES, trace_id);
             UMessage umsg(payload, attributes);
+            if (allocTraceEnabled() && total_sent == alloc_from) {
+                alloc_start = allocTraceProcess();
+            }
+            auto alloc_before = allocTraceThread();
+            traceFlow("message", trace_id, true);
             clock_gettime(CLOCK_MONOTONIC, &start);
+            stages.mark(STAGE_UMESSAGE, start, trace_id);
             UStatus status = pub->send(umsg);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            stages.mark(STAGE_SEND, end, trace_id);
+            stages.finish(UCode::OK == status.code() && topic.sent != 0);
+            if (allocTraceEnabled() && total_sent++ >= alloc_from) {
+                allocAdd(alloc_thread, allocDelta(allocTraceThread(), alloc_before));
+            }
+            // a failed send is counted and the run goes on, run_tests waits for the "Stop" of every publisher
             if (UCode::OK != status.code()) {
-                spdlog::error("send.send failed");
-                return UCode::UNAVAILABLE;
+                if (send_errors++ == 0) {
+                    spdlog::error("send failed, {}", status.message());
+                }
+            } else if (topic.sent != 0) {
+                // the first send of a topic declares its publisher, the warm-up of the rest is found by the windows
+                auto duration = getDuration(end, start);
+                series.add(start, duration);
+                if (tail.isTail(duration)) {
+                    tail.record({duration, app->index, topic.entity_id, topic.resource_id, topic.sent, start, end, {}, 0, 0});
+                }
             }
-            clock_gettime(CLOCK_MONOTONIC, &end);
-            if (i != 0) {
-                pub_vec.push_back(getDuration(end, start));
+            if (++topic.sent == loops) {
+                done++;
+                continue;
+            }
+            addMicroseconds(topic.next, topic.period_us);
+            if (!has_wake || isBefore(topic.next, wake)) {
+                wake = topic.next;
+                has_wake = true;
             }
-            s.str("");
         }
-        usleep(10);
-        //sleep here for different pub rate
+        if (has_wake) {
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr);
+        }
     }
+    auto alloc_end = allocTraceProcess();
     
   
     // write results to file
-    if (pub_vec.size() > 0) {
-        writeVecToFile(path, pub_vec);
+    writeSeries(dir, file_name, series);
+    spdlog::info("{} : {} windows, warm-up {:.3f} seconds ({} samples)", file_name, series.windows().size(),
+                 series.warmupSeconds(), series.warmup().size());
+    writeTail(dir, file_name, tail);
+    auto stage_stats = stages.stats();
+    printStages(file_name, stage_stats);
+    writeStages(dir, file_name, stages.samples(), stage_stats);
+    if (allocTraceEnabled() && total_sent > alloc_from) {
+        writeAllocTrace(dir, file_name, total_sent - alloc_from, alloc_thread, allocDelta(alloc_end, alloc_start));
+    }
+    if (send_errors > 0) {
+        spdlog::error("{} : {} sends failed", file_name, send_errors);
+    }
+    if (Tracer::enabled()) {
+        Tracer::instance().disable();
+        if (!Tracer::instance().write(dir / (TRACE_PREFIX + file_name + ".json"), file_name)) {
+            spdlog::error("{} : failed to write the trace", file_name);
+        }
+        if (auto overwritten = Tracer::instance().overwritten(); overwritten > 0) {
+            spdlog::warn("{} : the trace lost its {} oldest events", file_name, overwritten);
+        }
     }
     
     
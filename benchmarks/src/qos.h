@@ -0,0 +1,273 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_QOS_H
+#define UP_ZENOH_EXAMPLE_CPP_QOS_H
+
+#include "utils.h"
+#include "SessionPool.h"
+#include "report.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <spdlog/spdlog.h>
+
+using namespace uprotocol::utransport;
+using namespace uprotocol::uri;
+using namespace uprotocol::uuid;
+using namespace uprotocol::v1;
+
+constexpr int QOS_DURATION = 5;
+constexpr size_t QOS_BULK_SIZE = 16 * 1024;
+constexpr long QOS_PRIORITY_PERIOD_US = 10000;
+constexpr double QOS_TIMEOUT = 2.0;
+const std::string QOS_PIPE = "[\"unixpipe/qos.pipe\"]";
+
+/**
+ * binary header in the beginning of every qos message, seq 0 is a probe
+ */
+struct qos_header {
+    struct timespec sent;
+    uint32_t seq;
+    uint32_t priority;
+};
+
+class QosListener : public UListener {
+public:
+    UStatus onReceive(UMessage &umsg) override {
+        struct timespec tm{};
+        clock_gettime(CLOCK_MONOTONIC, &tm);
+        UStatus status;
+        auto payload = umsg.payload();
+        if (payload.isEmpty() || payload.size() < sizeof(qos_header)) {
+            status.set_code(UCode::INVALID_ARGUMENT);
+            return status;
+        }
+        qos_header header {};
+        std::memcpy(&header, payload.data(), sizeof(header));
+        if (header.seq == 0) {
+            probe_seen.store(true);
+        } else if (recording.load()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            duration_vec.push_back(getDuration(tm, header.sent));
+        }
+        status.set_code(UCode::OK);
+        return status;
+    }
+
+    auto take() -> std::vector<double> {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<double> res {};
+        res.swap(duration_vec);
+        return res;
+    }
+
+    std::atomic<bool> probe_seen {false};
+    std::atomic<bool> recording {false};
+
+private:
+    std::mutex mutex_;
+    std::vector<double> duration_vec {};
+};
+
+static inline auto qosUri(int id) -> UUri {
+    auto u_authority = BuildUAuthority().build();
+    auto u_entity = BuildUEntity().setId(id).setMajorVersion(1).build();
+    auto u_resource = BuildUResource().setID(id << 3).build();
+    return BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
+}
+
+static inline auto sendQos(PooledSession *session, const UUri &uri, UPriority priority, std::vector<uint8_t> &buffer, uint32_t seq) -> UStatus {
+    qos_header header {};
+    header.seq = seq;
+    header.priority = priority;
+    clock_gettime(CLOCK_MONOTONIC, &header.sent);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    auto uuid = Uuidv8Factory::create();
+    UAttributesBuilder builder(uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, priority);
+    UAttributes attributes = builder.build();
+    UPayload payload(buffer.data(), buffer.size(), UPayloadType::VALUE);
+    UMessage umsg(payload, attributes);
+    return session->send(umsg);
+}
+
+struct qos_result {
+    std::string name;
+    std::vector<double> priority_vec;
+    size_t bulk_sent;
+    size_t bulk_received;
+    double duration;
+};
+
+/**
+ * one scenario, a CS6 stream every period_us with (or without) a CS1 bulk stream as fast as possible
+ */
+static inline auto runQosScenario(const std::string &name, bool qos_enabled, bool bulk, int duration, size_t bulk_size, long period_us) -> std::optional<qos_result> {
+    ZenohSessionManagerConfig sub_config{};
+    sub_config.listenKey = QOS_PIPE;
+    sub_config.connectKey = "";
+    sub_config.qosEnabled = qos_enabled ? "true" : "false";
+    sub_config.lowLatency = "false"; // lowLatency requires qos to be disabled, keep it off in all the scenarios
+    sub_config.scouting_delay = 0;
+    ZenohSessionManagerConfig pub_config = sub_config;
+    pub_config.listenKey = "";
+    pub_config.connectKey = QOS_PIPE;
+
+    auto sub = std::make_unique<PooledSession>(sub_config);
+    auto pub = std::make_unique<PooledSession>(pub_config);
+    if (UCode::OK != sub->getSuccess().code() || UCode::OK != pub->getSuccess().code()) {
+        spdlog::error("ZenohUTransport init failed");
+        return std::nullopt;
+    }
+
+    auto priority_uri = qosUri(300);
+    auto bulk_uri = qosUri(301);
+    QosListener priority_listener {};
+    QosListener bulk_listener {};
+    if (UCode::OK != sub->registerListener(priority_uri, priority_listener).code() ||
+        UCode::OK != sub->registerListener(bulk_uri, bulk_listener).code()) {
+        spdlog::error("registerListener failed");
+        return std::nullopt;
+    }
+
+    std::vector<uint8_t> priority_buffer(sizeof(qos_header) + 64);
+    std::vector<uint8_t> bulk_buffer(std::max(bulk_size, sizeof(qos_header)));
+    fillbufferWithRandom(bulk_buffer.data(), 0, bulk_buffer.size());
+
+    // messages that are sent before the route to the subscriber exists are lost
+    struct timespec start{};
+    struct timespec end{};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (!priority_listener.probe_seen.load() || !bulk_listener.probe_seen.load()) {
+        sendQos(pub.get(), priority_uri, UPriority::UPRIORITY_CS6, priority_buffer, 0);
+        sendQos(pub.get(), bulk_uri, UPriority::UPRIORITY_CS1, priority_buffer, 0);
+        usleep(100);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (getDuration(end, start) > QOS_TIMEOUT) {
+            spdlog::error("no connection to the subscriber after {} seconds", QOS_TIMEOUT);
+            return std::nullopt;
+        }
+    }
+
+    priority_listener.recording.store(true);
+    bulk_listener.recording.store(true);
+    std::atomic<bool> running {true};
+    std::atomic<size_t> bulk_sent {0};
+    std::thread bulk_thread;
+    if (bulk) {
+        bulk_thread = std::thread([&]() {
+            uint32_t seq = 1;
+            while (running.load()) {
+                if (UCode::OK == sendQos(pub.get(), bulk_uri, UPriority::UPRIORITY_CS1, bulk_buffer, seq++).code()) {
+                    bulk_sent.fetch_add(1);
+                }
+            }
+        });
+    }
+
+    // the critical stream is sent on absolute deadlines so its rate does not depend on the send time
+    struct timespec deadline{};
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    start = deadline;
+    uint32_t seq = 1;
+    while (!terminate) {
+        deadline.tv_nsec += period_us * 1000;
+        while (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            deadline.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (getDuration(end, start) > duration) {
+            break;
+        }
+        sendQos(pub.get(), priority_uri, UPriority::UPRIORITY_CS6, priority_buffer, seq++);
+    }
+    running.store(false);
+    if (bulk_thread.joinable()) {
+        bulk_thread.join();
+    }
+    usleep(100000); // let the last messages arrive
+    priority_listener.recording.store(false);
+    bulk_listener.recording.store(false);
+
+    qos_result result {};
+    result.name = name;
+    result.priority_vec = priority_listener.take();
+    result.bulk_sent = bulk_sent.load();
+    result.bulk_received = bulk_listener.take().size();
+    result.duration = getDuration(end, start);
+
+    sub->unregisterListener(priority_uri, priority_listener);
+    sub->unregisterListener(bulk_uri, bulk_listener);
+    return result;
+}
+
+/**
+ * latency of a low rate CS6 stream without load, under CS1 bulk load with qos disabled
+ * and under the same load with qos enabled (priority lanes)
+ */
+auto qos(int duration, size_t bulk_size, long period_us, Report &report) -> int {
+    std::vector<qos_result> results {};
+    std::vector<std::tuple<std::string, bool, bool>> scenarios {
+        {"idle", false, false},
+        {"bulk noqos", false, true},
+        {"bulk qos", true, true}
+    };
+    for (auto const &scenario : scenarios) {
+        if (terminate) {
+            break;
+        }
+        auto result = runQosScenario(std::get<0>(scenario), std::get<1>(scenario), std::get<2>(scenario), duration, bulk_size, period_us);
+        if (!result.has_value()) {
+            return -1;
+        }
+        results.push_back(result.value());
+    }
+
+    auto expected = static_cast<size_t>(duration * 1000000L / period_us);
+    spdlog::info("CS6 every {} us, CS1 bulk of {} bytes, {} seconds per scenario", period_us, bulk_size, duration);
+    spdlog::info("{}", printHeader());
+    for (auto &result : results) {
+        auto count = result.priority_vec.size();
+        auto stat = getStats(result.priority_vec);
+        if (stat.has_value()) {
+            spdlog::info("{}", printStat(result.name, stat.value()));
+        }
+        auto bulk_bandwidth = result.duration > 0 ? result.bulk_received * bulk_size / result.duration / (1024.0 * 1024.0) : 0.0;
+        spdlog::info("{} : CS6 received {}/{}, CS1 received {}/{} ({:.1f} MB/s)", result.name, count, expected,
+                     result.bulk_received, result.bulk_sent, bulk_bandwidth);
+        auto row = makeReportRow(result.name, stat, count);
+        row.throughput = result.duration > 0 ? std::make_optional(count / result.duration) : std::nullopt;
+        row.lost = std::max(0L, static_cast<long>(expected) - static_cast<long>(count));
+        row.extra.emplace_back("bulk_sent", result.bulk_sent);
+        row.extra.emplace_back("bulk_received", result.bulk_received);
+        row.extra.emplace_back("bulk_mb_per_s", bulk_bandwidth);
+        report.add(row);
+    }
+    return 0;
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_QOS_H
@@ -0,0 +1,264 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_REPLAY_H
+#define UP_ZENOH_EXAMPLE_CPP_REPLAY_H
+
+#include "utils.h"
+#include "SessionPool.h"
+#include "Locator.h"
+#include "StreamLog.h"
+#include "report.h"
+#include <atomic>
+#include <map>
+#include <spdlog/spdlog.h>
+
+using namespace uprotocol::utransport;
+using namespace uprotocol::uri;
+using namespace uprotocol::uuid;
+using namespace uprotocol::v1;
+
+constexpr int RECORD_DURATION = 10;
+const std::string RECORD_TOPICS = "1:2,2:1,3:4,4:1"; // entity:resource, the topics of pubsub/pub
+const std::string REPLAY_PIPE = "[\"unixpipe/replay.pipe\"]";
+constexpr double REPLAY_TIMEOUT = 2.0;
+constexpr int REPLAY_PROBE_ID = 302;
+
+static inline auto replayUri(uint32_t entity_id, uint32_t resource_id) -> UUri {
+    auto u_authority = BuildUAuthority().build();
+    auto u_entity = BuildUEntity().setId(entity_id).setMajorVersion(1).build();
+    auto u_resource = BuildUResource().setID(resource_id).build();
+    return BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
+}
+
+/**
+ * entity:resource,entity:resource...
+ */
+static inline auto parseTopics(std::string topics) -> std::vector<UUri> {
+    std::vector<UUri> res {};
+    std::string delimiter = ",";
+    std::string colon = ":";
+    for (auto topic : split(topics, delimiter)) {
+        auto ids = split(topic, colon);
+        if (ids.size() != 2) {
+            continue;
+        }
+        res.push_back(replayUri(std::strtoul(ids[0].c_str(), nullptr, 10), std::strtoul(ids[1].c_str(), nullptr, 10)));
+    }
+    return res;
+}
+
+/**
+ * listens on endpoint (the examples connect to it) and appends the messages of the topics to the log at path
+ */
+auto record(const std::string &path, int duration, const std::string &endpoint, const std::string &topics, Report &report) -> int {
+    StreamRecorder recorder(path);
+    if (!recorder.isOpen()) {
+        spdlog::error("can't create {}, {}", path, strerror(errno));
+        return -1;
+    }
+    ZenohSessionManagerConfig config{};
+    config.listenKey = toEndpointList(endpoint);
+    config.connectKey = "";
+    config.qosEnabled = "false";
+    config.lowLatency = "true";
+    config.scouting_delay = 0;
+    auto sub = std::make_unique<PooledSession>(config);
+    if (UCode::OK != sub->getSuccess().code()) {
+        spdlog::error("ZenohUTransport init failed");
+        return -1;
+    }
+    auto uris = parseTopics(topics);
+    RecordingListener listener(recorder);
+    for (auto const &uri : uris) {
+        if (UCode::OK != sub->registerListener(uri, listener).code()) {
+            spdlog::error("registerListener failed");
+            return -1;
+        }
+    }
+    spdlog::info("recording {} topics on {} to {} for {} seconds", uris.size(), endpoint, path, duration);
+    struct timespec start{};
+    struct timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        usleep(100000);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while (!terminate && getDuration(now, start) < duration);
+    for (auto const &uri : uris) {
+        sub->unregisterListener(uri, listener);
+    }
+    sub.reset();
+    auto records = recorder.records();
+    auto bytes = recorder.bytes();
+    recorder.close();
+    auto seconds = getDuration(now, start);
+    spdlog::info("{} : {} messages, {} bytes in {:.3f} seconds", path, records, bytes, seconds);
+    auto row = makeReportRow("record", std::nullopt, records);
+    row.throughput = seconds > 0 ? std::make_optional(records / seconds) : std::nullopt;
+    row.extra.emplace_back("bytes", bytes);
+    report.add(row);
+    return 0;
+}
+
+class ReplayListener : public UListener {
+public:
+    UStatus onReceive(UMessage &umsg) override {
+        received.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(umsg.payload().size(), std::memory_order_relaxed);
+        UStatus status;
+        status.set_code(UCode::OK);
+        return status;
+    }
+
+    std::atomic<uint64_t> received {0};
+    std::atomic<uint64_t> bytes {0};
+};
+
+/**
+ * publishes the log at path to a subscriber in the same process at speed (1 the recorded timing, 0 as fast as
+ * possible), the same log is the same load in every run. with an endpoint the log is published to it instead
+ * (pubsub/sub or a recorder), without a local subscriber
+ */
+auto replay(const std::string &path, double speed, const std::string &endpoint, Report &report) -> int {
+    StreamReader reader(path);
+    if (!reader.isOpen()) {
+        spdlog::error("{} is not a stream log", path);
+        return -1;
+    }
+    // the topics of the log, one pass over the mapping
+    std::map<std::pair<uint32_t, uint32_t>, UUri> topics {};
+    stream_record record {};
+    UAttributes attributes {};
+    int64_t first = 0;
+    int64_t last = 0;
+    while (reader.next(record)) {
+        if (attributes.ParseFromArray(record.attributes, static_cast<int>(record.attributes_size))) {
+            auto const &source = attributes.source();
+            topics.emplace(std::make_pair(source.entity().id(), source.resource().id()), source);
+        }
+        first = first == 0 ? record.received : first;
+        last = record.received;
+    }
+    reader.rewind();
+    spdlog::info("{} : {} messages on {} topics, {} bytes, {:.3f} seconds recorded", path, reader.records(), topics.size(),
+                 reader.bytes(), (last - first) * 1.0e-9);
+
+    ZenohSessionManagerConfig sub_config{};
+    sub_config.listenKey = REPLAY_PIPE;
+    sub_config.connectKey = "";
+    sub_config.qosEnabled = "false";
+    sub_config.lowLatency = "true";
+    sub_config.scouting_delay = 0;
+    ZenohSessionManagerConfig pub_config = sub_config;
+    pub_config.listenKey = "";
+    pub_config.connectKey = endpoint.empty() ? REPLAY_PIPE : toEndpointList(endpoint);
+    std::unique_ptr<PooledSession> sub {};
+    if (endpoint.empty()) {
+        sub = std::make_unique<PooledSession>(sub_config);
+    }
+    auto pub = std::make_unique<PooledSession>(pub_config);
+    if ((sub != nullptr && UCode::OK != sub->getSuccess().code()) || UCode::OK != pub->getSuccess().code()) {
+        spdlog::error("ZenohUTransport init failed");
+        return -1;
+    }
+    ReplayListener listener {};
+    ReplayListener probe_listener {};
+    auto probe_uri = replayUri(REPLAY_PROBE_ID, REPLAY_PROBE_ID << 3);
+    if (sub != nullptr) {
+        for (auto const &topic : topics) {
+            if (UCode::OK != sub->registerListener(topic.second, listener).code()) {
+                spdlog::error("registerListener failed");
+                return -1;
+            }
+        }
+        if (UCode::OK != sub->registerListener(probe_uri, probe_listener).code()) {
+            spdlog::error("registerListener failed");
+            return -1;
+        }
+        // messages that are sent before the route to the subscriber exists are lost
+        std::vector<uint8_t> probe(8);
+        struct timespec start{};
+        struct timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        while (probe_listener.received.load() == 0) {
+            UPayload payload(probe.data(), probe.size(), UPayloadType::VALUE);
+            UMessage umsg(payload, UAttributesBuilder(probe_uri, Uuidv8Factory::create(), UMessageType::UMESSAGE_TYPE_PUBLISH,
+                                                      UPriority::UPRIORITY_CS2).build());
+            pub->send(umsg);
+            usleep(100);
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (getDuration(now, start) > REPLAY_TIMEOUT) {
+                spdlog::error("no connection to the subscriber after {} seconds", REPLAY_TIMEOUT);
+                return -1;
+            }
+        }
+    }
+
+    std::vector<double> send_vec {};
+    std::vector<double> lag_vec {};
+    send_vec.reserve(reader.records());
+    lag_vec.reserve(reader.records());
+    auto stat = replayStream(reader, *pub, speed, []() { return terminate; },
+                             [&](const stream_record&, double send_duration, double lag) {
+        send_vec.push_back(send_duration);
+        lag_vec.push_back(lag);
+    });
+    usleep(100000); // let the last messages arrive
+    if (sub != nullptr) {
+        for (auto const &topic : topics) {
+            sub->unregisterListener(topic.second, listener);
+        }
+        sub->unregisterListener(probe_uri, probe_listener);
+    }
+
+    auto mode = speed > 0.0 ? fmt::format("x{:g}", speed) : std::string("max");
+    spdlog::info("replay {} : {} sent, {} send errors, {} skipped in {:.3f} seconds ({:.1f} msg/s), {} received",
+                 mode, stat.messages, stat.errors, stat.skipped, stat.duration,
+                 stat.duration > 0 ? stat.messages / stat.duration : 0.0,
+                 sub != nullptr ? std::to_string(listener.received.load()) : std::string("-"));
+    spdlog::info("{}", printHeader());
+    auto send_stat = getStats(send_vec);
+    if (send_stat.has_value()) {
+        spdlog::info("{}", printStat("send", send_stat.value()));
+    }
+    auto lag_stat = getStats(lag_vec);
+    if (speed > 0.0 && lag_stat.has_value()) {
+        spdlog::info("{}", printStat("lag", lag_stat.value()));
+    }
+    auto row = makeReportRow("replay " + mode + " send", send_stat, send_vec.size());
+    row.throughput = stat.duration > 0 ? std::make_optional(stat.messages / stat.duration) : std::nullopt;
+    if (sub != nullptr) {
+        row.lost = std::max(0L, static_cast<long>(stat.messages) - static_cast<long>(listener.received.load()));
+    }
+    row.extra.emplace_back("send_errors", stat.errors);
+    row.extra.emplace_back("bytes", stat.bytes);
+    report.add(row);
+    if (speed > 0.0) {
+        report.add(makeReportRow("replay " + mode + " lag", lag_stat, lag_vec.size()));
+    }
+    return 0;
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_REPLAY_H
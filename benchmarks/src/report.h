@@ -0,0 +1,346 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_REPORT_H
+#define UP_ZENOH_EXAMPLE_CPP_REPORT_H
+
+#include "utils.h"
+#include "filesys.h"
+#include <mutex>
+#include <sys/utsname.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/version.h>
+
+// set by benchmarks/CMakeLists.txt
+#ifndef BENCHMARK_BUILD_TYPE
+#define BENCHMARK_BUILD_TYPE ""
+#endif
+#ifndef BENCHMARK_UP_CLIENT_ZENOH_VERSION
+#define BENCHMARK_UP_CLIENT_ZENOH_VERSION ""
+#endif
+#ifndef BENCHMARK_ZENOHC_VERSION
+#define BENCHMARK_ZENOHC_VERSION ""
+#endif
+
+const std::string REPORTS_DIR = "reports";
+
+/**
+ * one scenario of a benchmark, the optional fields are null in the json and empty in the csv
+ */
+struct report_row {
+    std::string scenario;
+    std::optional<Stat_s> stat;
+    size_t samples;
+    std::optional<double> throughput; // messages per second
+    std::optional<long> lost;
+    std::optional<long> out_of_sequence;
+    std::vector<std::pair<std::string, double>> extra {};
+};
+
+static inline auto makeReportRow(const std::string &scenario, const std::optional<Stat_s> &stat, size_t samples) -> report_row {
+    report_row row {};
+    row.scenario = scenario;
+    row.stat = stat;
+    row.samples = samples;
+    return row;
+}
+
+static inline auto readFirstLine(const std::string &file_name) -> std::string {
+    std::ifstream input_file(file_name);
+    std::string line {};
+    if (input_file) {
+        std::getline(input_file, line);
+    }
+    return line;
+}
+
+static inline auto getCpuModel() -> std::string {
+    std::ifstream input_file("/proc/cpuinfo");
+    std::string line {};
+    while (std::getline(input_file, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            auto pos = line.find(':');
+            if (pos != std::string::npos && pos + 2 <= line.size()) {
+                return line.substr(pos + 2);
+            }
+        }
+    }
+    return "";
+}
+
+static inline auto orUnknown(const std::string &str) -> std::string {
+    return str.empty() ? "unknown" : str;
+}
+
+/**
+ * the environment of the run, every report carries it so results from different machines
+ * and builds can be told apart
+ */
+static inline auto getRunMetadata(const std::string &target) -> std::vector<std::pair<std::string, std::string>> {
+    struct utsname name {};
+    std::string kernel {};
+    std::string host {};
+    if (uname(&name) == 0) {
+        kernel = std::string(name.sysname) + " " + name.release + " " + name.machine;
+        host = name.nodename;
+    }
+    auto now_time_t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::stringstream timestamp;
+    timestamp << std::put_time(std::gmtime(&now_time_t), "%Y-%m-%dT%H:%M:%SZ");
+    std::stringstream spdlog_version;
+    spdlog_version << SPDLOG_VER_MAJOR << "." << SPDLOG_VER_MINOR << "." << SPDLOG_VER_PATCH;
+    std::string protobuf_version {};
+#ifdef GOOGLE_PROTOBUF_VERSION
+    protobuf_version = std::to_string(GOOGLE_PROTOBUF_VERSION / 1000000) + "." +
+                       std::to_string(GOOGLE_PROTOBUF_VERSION / 1000 % 1000) + "." +
+                       std::to_string(GOOGLE_PROTOBUF_VERSION % 1000);
+#endif
+    return {
+        {"target", target},
+        {"timestamp", timestamp.str()},
+        {"host", orUnknown(host)},
+        {"kernel", orUnknown(kernel)},
+        {"cpu_model", orUnknown(getCpuModel())},
+        {"cpus", std::to_string(sysconf(_SC_NPROCESSORS_ONLN))},
+        {"governor", orUnknown(readFirstLine("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor"))},
+        {"build_type", orUnknown(BENCHMARK_BUILD_TYPE)},
+        {"compiler", __VERSION__},
+        {"up_client_zenoh_cpp", orUnknown(BENCHMARK_UP_CLIENT_ZENOH_VERSION)},
+        {"zenohc", orUnknown(BENCHMARK_ZENOHC_VERSION)},
+        {"protobuf", orUnknown(protobuf_version)},
+        {"spdlog", spdlog_version.str()}
+    };
+}
+
+static inline auto jsonString(const std::string &str) -> std::string {
+    std::stringstream s;
+    s << "\"";
+    for (auto c : str) {
+        switch (c) {
+            case '"':
+                s << "\\\"";
+                break;
+            case '\\':
+                s << "\\\\";
+                break;
+            case '\n':
+                s << "\\n";
+                break;
+            case '\t':
+                s << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    s << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                } else {
+                    s << c;
+                }
+        }
+    }
+    s << "\"";
+    return s.str();
+}
+
+static inline auto csvString(const std::string &str) -> std::string {
+    if (str.find_first_of(",\"\n") == std::string::npos) {
+        return str;
+    }
+    std::string res = "\"";
+    for (auto c : str) {
+        if (c == '"') {
+            res += '"';
+        }
+        res += c;
+    }
+    return res + "\"";
+}
+
+/**
+ * a double as json (null when missing or not finite) or csv (empty when missing)
+ */
+template<typename T>
+static inline auto formatValue(const std::optional<T> &value, bool json) -> std::string {
+    if (!value.has_value() || !std::isfinite(static_cast<double>(value.value()))) {
+        return json ? "null" : "";
+    }
+    std::stringstream s;
+    s << std::fixed << std::setprecision(std::is_integral<T>::value ? 0 : 9) << value.value();
+    return s.str();
+}
+
+static inline auto getStatFields(const std::optional<Stat_s> &stat) -> std::vector<std::pair<std::string, std::optional<double>>> {
+    Stat_s s = stat.value_or(Stat_s{});
+    return {
+        {"mean", s.mean},
+        {"median", s.median},
+        {"min", s.min},
+        {"max", s.max},
+        {"std", s.std},
+        {"skew", s.skew},
+        {"kurtosis", s.kurtosis},
+        {"p75", s.precentile_75},
+        {"p90", s.precentile_90},
+        {"p95", s.precentile_95},
+        {"p99", s.precentile_99}
+    };
+}
+
+/**
+ * structured results of one benchmark run next to the text output
+ * every scenario is a row with all the Stat_s fields, the counters and the run metadata,
+ * the json and csv files are written to a temporary file and renamed so a reader never sees half a report
+ */
+class Report {
+public:
+    explicit Report(std::string target) : target_(std::move(target)), metadata_(getRunMetadata(target_)) {}
+
+    auto add(const report_row &row) -> void {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rows_.push_back(row);
+    }
+
+    auto add(const std::string &scenario, const std::optional<Stat_s> &stat, size_t samples) -> void {
+        add(makeReportRow(scenario, stat, samples));
+    }
+
+    auto toJson() -> std::string {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::stringstream s;
+        s << "{\n  \"metadata\": {";
+        auto const &metadata = metadata_;
+        for (size_t i = 0; i < metadata.size(); i++) {
+            s << (i == 0 ? "\n" : ",\n") << "    " << jsonString(metadata[i].first) << ": " << jsonString(metadata[i].second);
+        }
+        s << "\n  },\n  \"results\": [";
+        for (size_t i = 0; i < rows_.size(); i++) {
+            auto const &row = rows_[i];
+            s << (i == 0 ? "\n" : ",\n") << "    {\"scenario\": " << jsonString(row.scenario)
+              << ", \"samples\": " << row.samples;
+            for (auto const &field : getStatFields(row.stat)) {
+                s << ", \"" << field.first << "\": " << formatValue(field.second, true);
+            }
+            s << ", \"throughput\": " << formatValue(row.throughput, true)
+              << ", \"lost\": " << formatValue(row.lost, true)
+              << ", \"out_of_sequence\": " << formatValue(row.out_of_sequence, true)
+              << ", \"extra\": {";
+            for (size_t j = 0; j < row.extra.size(); j++) {
+                s << (j == 0 ? "" : ", ") << jsonString(row.extra[j].first) << ": "
+                  << formatValue(std::make_optional(row.extra[j].second), true);
+            }
+            s << "}}";
+        }
+        s << "\n  ]\n}\n";
+        return s.str();
+    }
+
+    /**
+     * one line per scenario, the metadata is repeated on every line so a line can be used alone
+     * the extra values are key=value pairs separated by ';'
+     */
+    auto toCsv() -> std::string {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto const &metadata = metadata_;
+        std::stringstream s;
+        for (auto const &e : metadata) {
+            s << e.first << ",";
+        }
+        s << "scenario,samples";
+        for (auto const &field : getStatFields(std::nullopt)) {
+            s << "," << field.first;
+        }
+        s << ",throughput,lost,out_of_sequence,extra\n";
+        for (auto const &row : rows_) {
+            for (auto const &e : metadata) {
+                s << csvString(e.second) << ",";
+            }
+            s << csvString(row.scenario) << "," << row.samples;
+            for (auto const &field : getStatFields(row.stat)) {
+                s << "," << formatValue(field.second, false);
+            }
+            s << "," << formatValue(row.throughput, false)
+              << "," << formatValue(row.lost, false)
+              << "," << formatValue(row.out_of_sequence, false) << ",";
+            std::stringstream extra;
+            for (size_t j = 0; j < row.extra.size(); j++) {
+                extra << (j == 0 ? "" : ";") << row.extra[j].first << "=" << formatValue(std::make_optional(row.extra[j].second), false);
+            }
+            s << csvString(extra.str()) << "\n";
+        }
+        return s.str();
+    }
+
+    /**
+     * write <target>_<timestamp>.json and .csv to dir
+     */
+    auto write(const std::filesystem::path &dir) -> int {
+        if (rows_.empty()) {
+            return 0;
+        }
+        try {
+            std::filesystem::create_directories(dir);
+        } catch (const std::filesystem::filesystem_error &e) {
+            std::cerr << "Filesystem error : " << e.what() << std::endl;
+            return -1;
+        }
+        auto now_time_t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        auto file_name = target_;
+        std::replace(file_name.begin(), file_name.end(), ' ', '_');
+        std::stringstream s;
+        s << file_name << "_" << std::put_time(std::localtime(&now_time_t), "%y-%m-%d_%H-%M-%S");
+        auto base = dir / s.str();
+        auto json_file = base;
+        json_file += ".json";
+        auto csv_file = base;
+        csv_file += ".csv";
+        if (writeFileAtomic(json_file, toJson()) != 0 || writeFileAtomic(csv_file, toCsv()) != 0) {
+            return -1;
+        }
+        spdlog::info("report : {}", json_file.string());
+        return 0;
+    }
+
+private:
+    std::string target_;
+    std::vector<std::pair<std::string, std::string>> metadata_;
+    std::mutex mutex_;
+    std::vector<report_row> rows_ {};
+};
+
+/**
+ * the reports go to REPORT_DIR when it is set, otherwise to default_dir
+ */
+static inline auto getReportDir(const std::filesystem::path &default_dir) -> std::filesystem::path {
+    const char* report_dir = std::getenv("REPORT_DIR");
+    if (report_dir != nullptr) {
+        return std::filesystem::path(report_dir);
+    }
+    return default_dir;
+}
+
+static inline auto getReportDir() -> std::filesystem::path {
+    return getReportDir(std::filesystem::current_path() / "benchmarks" / REPORTS_DIR);
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_REPORT_H
@@ -29,6 +29,15 @@
 #include "utils.h"
 
 #include "filesys.h"
+#include "compare.h"
+#include "report.h"
+#include "window.h"
+#include "tail.h"
+#include "alloc_trace.h"
+#include "stages.h"
+#include "test_plan.h"
+#include "aggregate.h"
+#include "Trace.h"
 
 
 using namespace uprotocol::utransport;
@@ -83,54 +92,25 @@ static inline auto is_valid_name(const std::string &name) -> bool {
 };
 
 
-auto main(const int argc, char **argv) -> int {
-    std::signal(SIGINT, signalHandler);
-    std::signal(SIGTERM, signalHandler);
-    std::signal(SIGABRT, signalHandler);
-    int loops = NUMBER_OF_LOOPS;
-    int message_size = MESSAGE_SIZE;
-    int num_of_uri = 10;
-    int max_process = MAX_PROCESS;
-    auto now_time_t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    std::tm* local_time = std::localtime(&now_time_t);
-    std::stringstream s;
-    s << std::put_time(local_time, "%y-%m-%d_%H-%M-%S");
-    auto path = std::filesystem::current_path() / "benchmarks" / s.str();
-    //std::cout << path << std::endl;
-    try {
-        if (!std::filesystem::create_directory(path)) {
-            std::cerr << "directory already exists" << std::endl;
-        }
-    }catch (const std::filesystem::filesystem_error& e) {
-        std::cerr<< "Error creating directory. " << e.what() << std::endl;
-    }
-    
-    auto dir_path = std::filesystem::current_path() / "benchmarks";
-    auto dirs = getDirectories(dir_path);
-    sort(dirs.begin(), dirs.end());
-    
-    if (dirs.size() > 8) {
-        for (auto i = 0; i < 5; i++) {
-            remove_directory(dirs[i]);
-        }
-    }
+struct scenario_result {
+    std::string name;
+    std::optional<Stat_s> sub_stat;
+    std::optional<Stat_s> pub_stat;
+    size_t delivered;
+    double duration;
+};
 
-    if (argc >= 2) {
-        char *endptr;
-        loops = std::strtol(argv[1], &endptr, 10);
-    }
-    if (argc >= 3) {
-        char *endptr;
-        message_size = std::strtol(argv[2], &endptr, 10);
-    }
-    if (argc >= 4) {
-        char *endptr;
-        num_of_uri = std::strtol(argv[3], &endptr, 10);
-        if (NUMBER_OF_MAX_URI < num_of_uri) {
-            num_of_uri = NUMBER_OF_MAX_URI;
-        }
-    }
-    auto list_of_servers = createServerPortlist(max_process);
+/**
+ * run all the publishers and subscribers of the topology on one locator scheme
+ * the children get everything from the test plan, the results of the children are written to path
+ */
+auto runScenario(const std::filesystem::path &path,
+                 const topology_s &topology,
+                 const std::string &locator,
+                 test_plan_config plan_config,
+                 Report &report) -> std::optional<scenario_result> {
+    auto max_process = topology.pubs + topology.subs;
+    auto list_of_servers = createServerPortlist(topology, locator);
     
     for (auto const& entry : list_of_servers) {
         std::cout << entry.first << " : " << entry.second.first << "  " << entry.second.second << std::endl;
@@ -139,45 +119,27 @@ auto main(const int argc, char **argv) -> int {
     std::cout << "all pub :" << getAllPubKeys(list_of_servers) << std::endl;
     std::cout << "all sub :" << getAllSubKeys(list_of_servers) << std::endl;
     
-    auto loops_s = std::to_string(loops);
-    if (setenv("NUMBER_OF_MESSAGES", loops_s.c_str(), 1) < 0) {
-        std::cout << "failed to set environment variable" << std::endl;
-        exit(-1);
+    plan_config.topology = topology;
+    plan_config.locator = locator;
+    plan_config.working_dir = path.string();
+    auto plan_name = getTestPlanName();
+    if (createTestPlan(plan_name, plan_config) != 0) {
+        return std::nullopt;
     }
     
-    auto msg_size_s = std::to_string(message_size);
-    if (setenv("MESSAGE_SIZE", msg_size_s.c_str(), 1) < 0) {
-        std::cout << "failed to set environment variable" << std::endl;
-        exit(-1);
-    }
-    
-    std::vector<std::string> uri_vec {};
-    for (auto i = 0; i < num_of_uri; i++) {
-        auto u_authority = BuildUAuthority().build();
-        auto u_entity = BuildUEntity().setId(i + 1).setMajorVersion(1).build();
-        auto u_resource = BuildUResource().setID((i + 1) << 3).build(); //BuildUResource().setID(3).build();
-        auto u_uri = BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
-        auto v8uri = MicroUriSerializer::serialize(u_uri);
-        auto s= convertSerializedURItoString(v8uri);
-        uri_vec.push_back(s);
-    }
-    
-    char** argv_f = new char*[uri_vec.size() + 3]; // one for name and 1 for nullptr
-    for (size_t i = 2; i < uri_vec.size() + 2; i++) {
-        argv_f[i] = new char[uri_vec[i - 2].size() + 1];
-        strncpy(argv_f[i], uri_vec[i - 2].c_str(), uri_vec[i - 2].size());
-        argv_f[i][uri_vec[i - 2].size()] = '\0';
-    }
-    std::cout << std::endl;
-    argv_f[uri_vec.size() + 2] = nullptr;
+    char** argv_f = new char*[4]; // name, app, plan and nullptr
+    argv_f[2] = new char[plan_name.size() + 1];
+    strncpy(argv_f[2], plan_name.c_str(), plan_name.size());
+    argv_f[2][plan_name.size()] = '\0';
+    argv_f[3] = nullptr;
     std::vector<pid_t> child_pids;
     std::vector<shm_data> shm_vec;
    
     
     std::string name {};
     for (auto i = 0; i < max_process; i++) {
-        name = (i % 2 == 0) ?"./benchmarks/pub_test" : "./benchmarks/sub_test";
         std::string s = "app" + std::to_string(i);
+        name = (list_of_servers[s].first == PUB) ?"./benchmarks/pub_test" : "./benchmarks/sub_test";
         
         argv_f[0] = new char[name.size() + 1]; //application name
         argv_f[1] = new char[s.size() + 1]; //specific app instance
@@ -192,6 +154,7 @@ auto main(const int argc, char **argv) -> int {
             for (auto s : shm_vec) {
                 removeSharedMem(s);
             }
+            shm_unlink(plan_name.c_str());
             exit(-1);
         }
     }
@@ -200,6 +163,9 @@ auto main(const int argc, char **argv) -> int {
         const char* message = "Start";
         std::memcpy(shm.ptr, message, strlen(message) + 1);
     }
+    struct timespec run_start{};
+    struct timespec run_end{};
+    clock_gettime(CLOCK_MONOTONIC, &run_start);
     
     std::string stop = "Stop";
     while (true) {
@@ -213,7 +179,8 @@ auto main(const int argc, char **argv) -> int {
                 }
             }
         }
-        if (i == (max_process / 2)) {
+        if (i == topology.pubs) {
+            clock_gettime(CLOCK_MONOTONIC, &run_end);
             for (auto const &shm: shm_vec) {
                 const char * message = "Stop";
                 if (shm.shm_name.substr(1, 1) == "s") {
@@ -230,28 +197,380 @@ auto main(const int argc, char **argv) -> int {
         std::cout << "chiled process : " << child_pid << " terminated" << std::endl;
     }
     
-    // start process statistics
-    auto list  =  getFilesFromDir(path);
-    std::vector<double> pub_vec {};
-    std::vector<double> sub_vec {};
-    for (auto const& l :list) {
+    for (auto s : shm_vec) {
+        removeSharedMem(s);
+    }
+    shm_unlink(plan_name.c_str());
+    
+    // start process statistics, the files are loaded on all the cores
+    struct timespec post_start{};
+    struct timespec post_end{};
+    clock_gettime(CLOCK_MONOTONIC, &post_start);
+    std::vector<std::filesystem::path> pub_files {};
+    std::vector<std::filesystem::path> sub_files {};
+    std::vector<std::filesystem::path> warmup_files {};
+    std::vector<std::filesystem::path> window_files {};
+    std::vector<std::filesystem::path> tail_files {};
+    std::vector<std::filesystem::path> alloc_files {};
+    std::vector<std::filesystem::path> trace_files {};
+    std::vector<std::filesystem::path> stage_files {};
+    for (auto const& l : getFilesFromDir(path)) {
+        if (l.empty()) {
+            continue;
+        }
         std::filesystem::path local_path(l);
         auto file_name = local_path.filename().string();
-        if (file_name.substr(0,1) == "p") {
-            readFileToVec(local_path, pub_vec);
-        } if (file_name.substr(0,1) == "s") {
-            readFileToVec(local_path, sub_vec);
+        if (file_name.rfind(WARMUP_PREFIX, 0) == 0) {
+            warmup_files.push_back(local_path);
+        } else if (file_name.rfind(WINDOW_PREFIX, 0) == 0) {
+            window_files.push_back(local_path);
+        } else if (file_name.rfind(TAIL_PREFIX, 0) == 0) {
+            tail_files.push_back(local_path);
+        } else if (file_name.rfind(ALLOC_TRACE_PREFIX, 0) == 0) {
+            alloc_files.push_back(local_path);
+        } else if (file_name.rfind(TRACE_PREFIX, 0) == 0) {
+            trace_files.push_back(local_path);
+        } else if (file_name.rfind(STAGES_PREFIX, 0) == 0) {
+            stage_files.push_back(local_path);
+        } else if (file_name.rfind(PUB_SAMPLES_PREFIX, 0) == 0) {
+            pub_files.push_back(local_path);
+        } else if (file_name.rfind(SUB_SAMPLES_PREFIX, 0) == 0) {
+            sub_files.push_back(local_path);
         }
     }
+    std::sort(sub_files.begin(), sub_files.end());
+    std::sort(window_files.begin(), window_files.end());
+    // the warm-up samples are not in the stats but they were sent and delivered
+    std::unordered_map<std::string, size_t> warmup_count {};
+    auto warmup_loaded = loadFilesParallel(warmup_files);
+    for (size_t i = 0; i < warmup_files.size(); i++) {
+        warmup_count[warmup_files[i].filename().string().substr(WARMUP_PREFIX.size())] = warmup_loaded[i].size();
+    }
+    warmup_loaded.clear();
+    size_t pub_warmup = 0;
+    size_t sub_warmup = 0;
+    for (auto const &e : warmup_count) {
+        (e.first.substr(0,1) == "p" ? pub_warmup : sub_warmup) += e.second;
+    }
+    auto pub_loaded = loadFilesParallel(pub_files);
+    auto sub_loaded = loadFilesParallel(sub_files);
+    auto pub_vec = concat(pub_loaded);
+    auto sub_vec = concat(sub_loaded);
+    pub_loaded.clear();
+    std::vector<std::pair<std::string, std::vector<double>>> per_sub {};
+    for (size_t i = 0; i < sub_files.size(); i++) {
+        per_sub.emplace_back(sub_files[i].filename().string(), std::move(sub_loaded[i]));
+    }
     
-    auto sub_stat = getStats(sub_vec);
-    auto pub_stat = getStats(pub_vec);
+    scenario_result result {};
+    result.name = locator;
+    result.duration = getDuration(run_end, run_start);
+    result.delivered = sub_vec.size();
+    auto published = pub_vec.size() + pub_warmup;
+    result.sub_stat = getStatsParallel(sub_vec);
+    result.pub_stat = getStatsParallel(pub_vec);
+    auto run_duration = result.duration;
+    // every subscriber listens to all the topics and every publisher connects to every subscriber
+    long expected = static_cast<long>(published) * topology.subs;
+    auto delivered = result.delivered + sub_warmup;
+    auto scenario_name = topologyToString(topology) + " " + locator;
+    auto sub_row = makeReportRow(scenario_name + " subscribe", result.sub_stat, result.delivered);
+    sub_row.throughput = run_duration > 0 ? std::make_optional(delivered / run_duration) : std::nullopt;
+    sub_row.lost = std::max(0L, expected - static_cast<long>(delivered));
+    sub_row.extra.emplace_back("publishers", topology.pubs);
+    sub_row.extra.emplace_back("subscribers", topology.subs);
+    sub_row.extra.emplace_back("warmup_samples", sub_warmup);
+    sub_row.extra.emplace_back("recv_shards", plan_config.recv_shards);
+    report.add(sub_row);
+    auto pub_row = makeReportRow(scenario_name + " publish", result.pub_stat, pub_vec.size());
+    pub_row.extra.emplace_back("warmup_samples", pub_warmup);
+    report.add(pub_row);
+    spdlog::info("topology {} over {} : {} publishers, {} subscribers", topologyToString(topology), locator, topology.pubs, topology.subs);
     spdlog::info("{}", printHeader());
-    spdlog::info("{}", printStat("subscribe", sub_stat.value()));
-    spdlog::info("{}", printStat("publish", pub_stat.value()));
+    if (result.sub_stat.has_value()) {
+        spdlog::info("{}", printStat("subscribe", result.sub_stat.value()));
+    }
+    if (result.pub_stat.has_value()) {
+        spdlog::info("{}", printStat("publish", result.pub_stat.value()));
+    }
     
-    for (auto s : shm_vec) {
-        removeSharedMem(s);
+    // the latency of every subscriber and the skew between the subscribers
+    std::vector<double> sub_median {};
+    std::vector<double> sub_p99 {};
+    for (auto &e : per_sub) {
+        auto count = e.second.size() + warmup_count[e.first];
+        auto stat = getStatsParallel(e.second);
+        if (!stat.has_value()) {
+            continue;
+        }
+        spdlog::info("{}", printStat(e.first.substr(4), stat.value()));
+        spdlog::info("{} : {} messages, {:.1f} msg/s", e.first, count, run_duration > 0 ? count / run_duration : 0.0);
+        auto row = makeReportRow(scenario_name + " " + e.first, stat, count);
+        row.throughput = run_duration > 0 ? std::make_optional(count / run_duration) : std::nullopt;
+        row.lost = std::max(0L, static_cast<long>(published) - static_cast<long>(count));
+        report.add(row);
+        sub_median.push_back(stat.value().median.value());
+        sub_p99.push_back(stat.value().precentile_99.value());
+    }
+    if (sub_median.size() > 1) {
+        auto median_range = std::minmax_element(sub_median.begin(), sub_median.end());
+        auto p99_range = std::minmax_element(sub_p99.begin(), sub_p99.end());
+        spdlog::info("subscriber skew : median {:.9f} (min {:.9f} max {:.9f}), 99% {:.9f} (min {:.9f} max {:.9f})",
+                     *median_range.second - *median_range.first, *median_range.first, *median_range.second,
+                     *p99_range.second - *p99_range.first, *p99_range.first, *p99_range.second);
+    }
+    spdlog::info("aggregate delivery : {} messages in {:.3f} seconds, {:.1f} msg/s, {:.1f} msg/s per subscriber",
+                 delivered, run_duration,
+                 run_duration > 0 ? delivered / run_duration : 0.0,
+                 run_duration > 0 ? delivered / run_duration / topology.subs : 0.0);
+    
+    // the windows of every process, the offsets are from the start of the run
+    auto origin = (double)run_start.tv_sec + (double)run_start.tv_nsec * 1.0e-9;
+    for (auto const &file : window_files) {
+        auto name = file.filename().string().substr(WINDOW_PREFIX.size());
+        name = name.substr(0, name.size() - std::string(".csv").size());
+        auto summary = summarizeWindows(readWindows(file), origin);
+        if (summary.windows == 0) {
+            continue;
+        }
+        spdlog::info("{} : {} windows of {} ms, warm-up {:.3f} s ({} samples), {} empty, worst p99 {:.9f} at {:.1f} s, worst max {:.9f} at {:.1f} s",
+                     name, summary.windows, plan_config.window_us / 1000, summary.warmup, warmup_count[name], summary.empty,
+                     summary.worst_p99, summary.worst_p99_at, summary.worst_max, summary.worst_max_at);
+        auto row = makeReportRow(scenario_name + " " + name + " windows", std::nullopt, summary.windows);
+        row.extra.emplace_back("window_ms", plan_config.window_us / 1000.0);
+        row.extra.emplace_back("warmup_s", summary.warmup);
+        row.extra.emplace_back("warmup_samples", warmup_count[name]);
+        row.extra.emplace_back("empty_windows", summary.empty);
+        row.extra.emplace_back("worst_p99", summary.worst_p99);
+        row.extra.emplace_back("worst_p99_at_s", summary.worst_p99_at);
+        row.extra.emplace_back("worst_max", summary.worst_max);
+        row.extra.emplace_back("worst_max_at_s", summary.worst_max_at);
+        report.add(row);
+    }
+    
+    // the slow samples of all the processes with their context, slowest first
+    auto tails = mergeTails(tail_files);
+    if (!tails.empty()) {
+        std::stringstream tail_csv;
+        tail_csv << tailHeader() << "\n";
+        for (auto const &e : tails) {
+            tail_csv << e.second << "\n";
+        }
+        writeFileAtomic(path / "tail.csv", tail_csv.str());
+        spdlog::info("slowest samples ({} kept, all in {}) :", tails.size(), (path / "tail.csv").string());
+        spdlog::info("{}", tailHeader());
+        for (size_t i = 0; i < std::min<size_t>(10, tails.size()); i++) {
+            spdlog::info("{}", tails[i].second);
+        }
+    }
+    // the steady state allocations per message of every process, only with -DBENCHMARK_ALLOC_TRACE=ON
+    std::sort(alloc_files.begin(), alloc_files.end());
+    for (auto const &file : alloc_files) {
+        auto alloc = readAllocTrace(file);
+        if (!alloc.has_value() || alloc->messages == 0) {
+            continue;
+        }
+        auto name = file.filename().string().substr(ALLOC_TRACE_PREFIX.size());
+        name = name.substr(0, name.size() - std::string(".csv").size());
+        auto per_message = [&](uint64_t value) {
+            return static_cast<double>(value) / alloc->messages;
+        };
+        spdlog::info("{} : {} messages, {:.2f} allocs {:.1f} bytes per message on the {} thread, {:.2f} allocs {:.1f} bytes per message in the process",
+                     name, alloc->messages, per_message(alloc->thread.allocs), per_message(alloc->thread.bytes),
+                     name.substr(0,1) == "p" ? "send" : "callback",
+                     per_message(alloc->process.allocs), per_message(alloc->process.bytes));
+        auto row = makeReportRow(scenario_name + " " + name + " allocations", std::nullopt, alloc->messages);
+        row.extra.emplace_back("thread_allocs_per_msg", per_message(alloc->thread.allocs));
+        row.extra.emplace_back("thread_bytes_per_msg", per_message(alloc->thread.bytes));
+        row.extra.emplace_back("process_allocs_per_msg", per_message(alloc->process.allocs));
+        row.extra.emplace_back("process_bytes_per_msg", per_message(alloc->process.bytes));
+        row.extra.emplace_back("process_frees_per_msg", per_message(alloc->process.frees));
+        report.add(row);
+    }
+    // where the time of a published message goes, stage by stage for every publisher
+    std::sort(stage_files.begin(), stage_files.end());
+    for (auto const &file : stage_files) {
+        size_t samples = 0;
+        auto stages = readStages(file, samples);
+        if (stages.empty()) {
+            continue;
+        }
+        auto name = file.filename().string().substr(STAGES_PREFIX.size());
+        name = name.substr(0, name.size() - std::string(".csv").size());
+        printStages(name, stages);
+        addStagesToReport(report, scenario_name + " " + name, samples, stages);
+    }
+    // the lifecycle traces of all the processes in one timeline, only with UP_TRACE set
+    if (!trace_files.empty()) {
+        std::sort(trace_files.begin(), trace_files.end());
+        writeFileAtomic(path / "trace.json", mergeTraces(trace_files));
+        spdlog::info("trace of {} processes in {}", trace_files.size(), (path / "trace.json").string());
+    }
+    clock_gettime(CLOCK_MONOTONIC, &post_end);
+    spdlog::info("post processing : {} samples in {:.3f} seconds on {} threads", sub_vec.size() + pub_vec.size(),
+                 getDuration(post_end, post_start), getNumberOfWorkers());
+    
+    return result;
+}
+
+auto main(int argc, char **argv) -> int {
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+    std::signal(SIGABRT, signalHandler);
+    // run_tests baseline|compare ... - save the run as the baseline or compare it with the baseline
+    std::string mode {};
+    if (argc >= 2 && (std::string("baseline") == argv[1] || std::string("compare") == argv[1])) {
+        mode = argv[1];
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+    int loops = NUMBER_OF_LOOPS;
+    int message_size = MESSAGE_SIZE;
+    int num_of_uri = 10;
+    topology_s topology {MAX_PROCESS / 2, MAX_PROCESS / 2};
+    std::vector<std::string> locators {LOCATOR_SCHEMES[0]};
+    auto now_time_t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm* local_time = std::localtime(&now_time_t);
+    std::stringstream s;
+    s << std::put_time(local_time, "%y-%m-%d_%H-%M-%S");
+    auto path = std::filesystem::current_path() / "benchmarks" / s.str();
+    //std::cout << path << std::endl;
+    try {
+        if (!std::filesystem::create_directory(path)) {
+            std::cerr << "directory already exists" << std::endl;
+        }
+    }catch (const std::filesystem::filesystem_error& e) {
+        std::cerr<< "Error creating directory. " << e.what() << std::endl;
     }
     
+    auto dir_path = std::filesystem::current_path() / "benchmarks";
+    auto dirs = getDirectories(dir_path);
+    sort(dirs.begin(), dirs.end());
+    
+    if (dirs.size() > 8) {
+        for (auto i = 0; i < 5; i++) {
+            remove_directory(dirs[i]);
+        }
+    }
+
+    if (argc >= 2) {
+        char *endptr;
+        loops = std::strtol(argv[1], &endptr, 10);
+    }
+    if (argc >= 3) {
+        char *endptr;
+        message_size = std::strtol(argv[2], &endptr, 10);
+    }
+    if (argc >= 4) {
+        char *endptr;
+        num_of_uri = std::strtol(argv[3], &endptr, 10);
+        if (static_cast<int>(TEST_PLAN_MAX_TOPICS) < num_of_uri) {
+            num_of_uri = TEST_PLAN_MAX_TOPICS;
+        }
+    }
+    // run_tests [loops] [message size] [number of uri] [PxS] [locator,locator...] [seed] [tail threshold us] [receive shards]
+    if (argc >= 5) {
+        auto res = parseTopology(argv[4]);
+        if (!res.has_value()) {
+            std::cout << "invalid topology " << argv[4] << " expected <publishers>x<subscribers>" << std::endl;
+            exit(-1);
+        }
+        topology = res.value();
+    }
+    if (argc >= 6) {
+        std::string data = argv[5];
+        std::string delimiter = ",";
+        locators = split(data, delimiter);
+        if (locators.size() == 1 && locators[0] == "all") {
+            locators = LOCATOR_SCHEMES;
+        }
+    }
+    
+    test_plan_config plan_config {};
+    plan_config.seed = TEST_PLAN_SEED;
+    if (argc >= 7) {
+        char *endptr;
+        plan_config.seed = std::strtoull(argv[6], &endptr, 10);
+    }
+    plan_config.loops = loops;
+    plan_config.message_size = message_size;
+    plan_config.period_us = TEST_PLAN_PERIOD_US;
+    plan_config.window_us = WINDOW_US;
+    plan_config.tail_threshold_us = TAIL_THRESHOLD_US;
+    plan_config.tail_capacity = TAIL_CAPACITY;
+    if (argc >= 8) {
+        char *endptr;
+        plan_config.tail_threshold_us = std::strtoul(argv[7], &endptr, 10);
+    }
+    plan_config.recv_shards = 0;
+    if (argc >= 9) {
+        char *endptr;
+        plan_config.recv_shards = std::strtoul(argv[8], &endptr, 10);
+    }
+    plan_config.num_topics = num_of_uri;
+    
+    // every locator scheme is a scenario with its own directory under the run directory
+    std::vector<scenario_result> results {};
+    Report report("run_tests");
+    bool regression = false;
+    for (auto const &locator : locators) {
+        if (terminate) {
+            break;
+        }
+        if (!isLocatorAvailable(locator)) {
+            spdlog::warn("locator {} is not available, skipped", locator);
+            continue;
+        }
+        auto scenario_path = path / locator;
+        try {
+            std::filesystem::create_directory(scenario_path);
+        } catch (const std::filesystem::filesystem_error& e) {
+            std::cerr<< "Error creating directory. " << e.what() << std::endl;
+            continue;
+        }
+        auto result = runScenario(scenario_path, topology, locator, plan_config, report);
+        if (result.has_value()) {
+            results.push_back(result.value());
+        }
+        // every dimension of the run is in the key, a run is only compared with a baseline of the same scenario
+        auto scenario = topologyToString(topology) + "_" + locator + "_" + std::to_string(message_size) + "_" +
+                        std::to_string(num_of_uri) + "_" + std::to_string(loops) + "l_" +
+                        std::to_string(plan_config.recv_shards) + "sh";
+        if (mode == "baseline") {
+            saveBaseline(scenario, scenario_path);
+            appendHistory(scenario, scenario_path, "baseline");
+        } else if (mode == "compare") {
+            regression = compareWithBaseline(scenario, scenario_path) || regression;
+        }
+    }
+    
+    if (results.size() > 1) {
+        spdlog::info("locators side by side, topology {}", topologyToString(topology));
+        spdlog::info("{}", printHeader());
+        for (auto const &result : results) {
+            if (result.sub_stat.has_value()) {
+                auto stat = result.sub_stat.value();
+                spdlog::info("{}", printStat("s " + result.name, stat));
+            }
+        }
+        for (auto const &result : results) {
+            if (result.pub_stat.has_value()) {
+                auto stat = result.pub_stat.value();
+                spdlog::info("{}", printStat("p " + result.name, stat));
+            }
+        }
+        for (auto const &result : results) {
+            spdlog::info("{} : {} messages in {:.3f} seconds, {:.1f} msg/s", result.name, result.delivered, result.duration,
+                         result.duration > 0 ? result.delivered / result.duration : 0.0);
+        }
+    }
+    
+    report.write(getReportDir(path));
+    
+    if (regression) {
+        spdlog::error("performance regression against the baseline");
+        return 1;
+    }
+    return 0;
 }
@@ -0,0 +1,220 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_STAGES_H
+#define UP_ZENOH_EXAMPLE_CPP_STAGES_H
+
+#include "utils.h"
+#include "filesys.h"
+#include "report.h"
+#include "Trace.h"
+#include <array>
+#include <spdlog/spdlog.h>
+
+const std::string STAGES_PREFIX = "stages-";
+
+/**
+ * the stages of a published message, in order
+ */
+enum publish_stage : size_t {
+    STAGE_PAYLOAD = 0,  // format the payload
+    STAGE_UUID,         // the id of the message from the UuidPool of the thread
+    STAGE_ATTRIBUTES,   // the attributes of the message with the new id
+    STAGE_UMESSAGE,     // UMessage from the payload and the attributes
+    STAGE_SEND,         // transport->send
+    PUBLISH_STAGES
+};
+
+constexpr std::array<const char*, PUBLISH_STAGES> PUBLISH_STAGE_NAMES = {"payload", "uuid", "attributes", "umessage", "send"};
+constexpr const char *STAGE_TOTAL = "total";
+
+/**
+ * times the stages of every message with one clock read between two stages, mark() ends a stage where the
+ * previous one ended so the stages of a message add up to its total. the stages are also trace events
+ * (Trace.h) when tracing is enabled
+ */
+class StageTimer {
+public:
+    explicit StageTimer(size_t reserve = 0) {
+        for (auto &v : samples_) {
+            v.reserve(reserve);
+        }
+        total_.reserve(reserve);
+    }
+
+    inline auto start(const struct timespec &now) -> void {
+        first_ = now;
+        last_ = now;
+    }
+
+    inline auto start() -> void {
+        struct timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        start(now);
+    }
+
+    inline auto mark(publish_stage stage, const struct timespec &now, uint64_t trace_id = 0) -> void {
+        current_[stage] = toSeconds(now) - toSeconds(last_);
+        traceSpan(PUBLISH_STAGE_NAMES[stage], last_, now, trace_id);
+        last_ = now;
+    }
+
+    inline auto mark(publish_stage stage, uint64_t trace_id = 0) -> void {
+        struct timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        mark(stage, now, trace_id);
+    }
+
+    /**
+     * the stages of the message go to the samples, a message that is not kept (warm-up, failed send) is dropped
+     */
+    inline auto finish(bool keep) -> void {
+        if (keep) {
+            for (size_t i = 0; i < PUBLISH_STAGES; i++) {
+                samples_[i].push_back(current_[i]);
+            }
+            total_.push_back(toSeconds(last_) - toSeconds(first_));
+        }
+        current_.fill(0.0);
+    }
+
+    /**
+     * the statistics of every stage and of the total, sorts the samples
+     */
+    auto stats() -> std::vector<std::pair<std::string, std::optional<Stat_s>>> {
+        std::vector<std::pair<std::string, std::optional<Stat_s>>> res {};
+        for (size_t i = 0; i < PUBLISH_STAGES; i++) {
+            res.emplace_back(PUBLISH_STAGE_NAMES[i], getStats(samples_[i]));
+        }
+        res.emplace_back(STAGE_TOTAL, getStats(total_));
+        return res;
+    }
+
+    auto samples() const -> size_t {
+        return total_.size();
+    }
+
+private:
+    static inline auto toSeconds(const struct timespec &tm) -> double {
+        return static_cast<double>(tm.tv_sec) + static_cast<double>(tm.tv_nsec) * 1.0e-9;
+    }
+
+    std::array<std::vector<double>, PUBLISH_STAGES> samples_ {};
+    std::vector<double> total_ {};
+    std::array<double, PUBLISH_STAGES> current_ {};
+    struct timespec first_ {};
+    struct timespec last_ {};
+};
+
+/**
+ * the stages stacked as the share of the mean of the total, with their mean and p99
+ */
+static inline auto printStages(const std::string &name, const std::vector<std::pair<std::string, std::optional<Stat_s>>> &stages) -> void {
+    double total = 0;
+    for (auto const &e : stages) {
+        if (e.first != STAGE_TOTAL && e.second.has_value()) {
+            total += e.second->mean.value_or(0);
+        }
+    }
+    spdlog::info("{} : {:<10} {:<11} {:<11} {:>6}", name, "stage", "mean", "p99", "share");
+    for (auto const &e : stages) {
+        if (!e.second.has_value()) {
+            continue;
+        }
+        auto mean = e.second->mean.value_or(0);
+        auto share = e.first == STAGE_TOTAL || total <= 0 ? 100.0 : mean / total * 100.0;
+        spdlog::info("{} : {:<10} {:.9f} {:.9f} {:5.1f}% {}", name, e.first, mean, e.second->precentile_99.value_or(0),
+                     share, e.first == STAGE_TOTAL ? "" : std::string(static_cast<size_t>(share / 2.5 + 0.5), '#'));
+    }
+}
+
+/**
+ * a report row per stage, scenario is "<name> <stage>"
+ */
+static inline auto addStagesToReport(Report &report, const std::string &name, size_t samples,
+                                     const std::vector<std::pair<std::string, std::optional<Stat_s>>> &stages) -> void {
+    double total = 0;
+    for (auto const &e : stages) {
+        if (e.first != STAGE_TOTAL && e.second.has_value()) {
+            total += e.second->mean.value_or(0);
+        }
+    }
+    for (auto const &e : stages) {
+        auto row = makeReportRow(name + " " + e.first, e.second, samples);
+        if (e.first != STAGE_TOTAL && e.second.has_value() && total > 0) {
+            row.extra.emplace_back("share", e.second->mean.value_or(0) / total);
+        }
+        report.add(row);
+    }
+}
+
+/**
+ * the stages of a process in stages-<file_name>.csv for run_tests
+ */
+static inline auto writeStages(const std::filesystem::path &dir, const std::string &file_name, size_t samples,
+                               const std::vector<std::pair<std::string, std::optional<Stat_s>>> &stages) -> int {
+    std::stringstream s;
+    s << "stage,samples,mean,median,p90,p99,max\n" << std::fixed << std::setprecision(9);
+    for (auto const &e : stages) {
+        if (!e.second.has_value()) {
+            continue;
+        }
+        s << e.first << "," << samples << "," << e.second->mean.value_or(0) << "," << e.second->median.value_or(0) << ","
+          << e.second->precentile_90.value_or(0) << "," << e.second->precentile_99.value_or(0) << ","
+          << e.second->max.value_or(0) << "\n";
+    }
+    return writeFileAtomic(dir / (STAGES_PREFIX + file_name + ".csv"), s.str());
+}
+
+static inline auto readStages(const std::filesystem::path &path, size_t &samples) -> std::vector<std::pair<std::string, std::optional<Stat_s>>> {
+    std::vector<std::pair<std::string, std::optional<Stat_s>>> res {};
+    std::ifstream in(path);
+    std::string line {};
+    std::getline(in, line);
+    while (std::getline(in, line)) {
+        std::stringstream s(line);
+        std::string stage {};
+        std::string value {};
+        std::getline(s, stage, ',');
+        std::vector<double> values {};
+        while (std::getline(s, value, ',')) {
+            values.push_back(std::strtod(value.c_str(), nullptr));
+        }
+        if (values.size() != 6) {
+            continue;
+        }
+        samples = static_cast<size_t>(values[0]);
+        Stat_s stat {};
+        stat.mean = values[1];
+        stat.median = values[2];
+        stat.precentile_90 = values[3];
+        stat.precentile_99 = values[4];
+        stat.max = values[5];
+        res.emplace_back(stage, stat);
+    }
+    return res;
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_STAGES_H
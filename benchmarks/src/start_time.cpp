@@ -24,6 +24,10 @@
 //
 
 #include "utils.h"
+#include "SessionPool.h"
+#include "UuidPool.h"
+#include "report.h"
+#include <atomic>
 #include <spdlog/spdlog.h>
 
 using namespace uprotocol::utransport;
@@ -47,7 +51,7 @@ public :
 
 
 
-auto start_session(const int loops, int msg_size, int max_uri) -> void {
+auto start_session(const int loops, int msg_size, int max_uri, Report &report) -> void {
     std::vector<double> open_session {};
     std::vector<double> close_session {};
     std::vector<double> pub_vec {};
@@ -97,7 +101,7 @@ auto start_session(const int loops, int msg_size, int max_uri) -> void {
             if (msg_size - len > 0) {
                 s << generateRandomString(msg_size - len);
             }
-            auto uuid = Uuidv8Factory::create();
+            auto uuid = UuidPool::local().next();
     
             UAttributesBuilder builder(uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
             UAttributes attributes = builder.build();
@@ -124,14 +128,524 @@ auto start_session(const int loops, int msg_size, int max_uri) -> void {
         close_session.push_back(getDuration(end, start));
     }
     
-    auto open_session_stat = getStats(open_session);
-    auto close_session_stat = getStats(close_session);
-    auto pub_stat = getStats(pub_vec);
     spdlog::info("{}", printHeader());
-    spdlog::info("{}", printStat("open session", open_session_stat.value()));
-    spdlog::info("{}", printStat("close session", close_session_stat.value()));
-    spdlog::info("{}", printStat("first publish", pub_stat.value()));
+    std::vector<std::pair<std::string, std::vector<double>*>> results {
+        {"open session", &open_session},
+        {"close session", &close_session},
+        {"first publish", &pub_vec}
+    };
+    for (auto &result : results) {
+        auto stat = getStats(*result.second);
+        if (stat.has_value()) {
+            spdlog::info("{}", printStat(result.first, stat.value()));
+        }
+        report.add(result.first, stat, result.second->size());
+    }
+    
+}
+
+static inline auto prepareAttributes(int max_uri, std::vector<UUri> &uri_vec, std::vector<UAttributes> &attr_vec) -> void {
+    for (auto i = 0; i < max_uri; i++) {
+        auto u_authority = BuildUAuthority().build();
+        auto u_entity = BuildUEntity().setId(i + 20).setMajorVersion(1).build();
+        auto u_resource = BuildUResource().setID((i + 20) << 3).build();
+        auto u_uri = BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
+        auto uuid = Uuidv8Factory::create();
+        UAttributesBuilder builder(u_uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
+        attr_vec.push_back(builder.build());
+        uri_vec.push_back(u_uri);
+    }
+}
+
+/**
+ * startup of an application with two components (for example a publisher and an rpc server)
+ * before - each component opens its own session synchronously and then the URIs and attributes are built
+ * after  - the SessionPool opens the session while the URIs and attributes are built and the
+ *          second component reuses the warm session
+ */
+auto pool_session(const int loops, int max_uri, Report &report) -> void {
+    std::vector<double> sync_first {};
+    std::vector<double> sync_second {};
+    std::vector<double> sync_total {};
+    std::vector<double> pool_first {};
+    std::vector<double> pool_second {};
+    std::vector<double> pool_total {};
+    
+    ZenohSessionManagerConfig config{};
+    config.listenKey = "[\"unixpipe/test.pipe\"]";
+    config.connectKey = "";
+    config.qosEnabled = "false";
+    config.lowLatency = "true";
+    config.scouting_delay = 0;
+    
+    ZenohSessionManagerConfig second_config = config;
+    second_config.listenKey = "[\"unixpipe/test2.pipe\"]";
+    
+    for (auto i = 0; i < loops && !terminate; i++) {
+        struct timespec start{};
+        struct timespec first{};
+        struct timespec end{};
+        std::vector<UUri> uri_vec {};
+        std::vector<UAttributes> attr_vec {};
+        
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        auto *session = new Session(config);
+        prepareAttributes(max_uri, uri_vec, attr_vec);
+        clock_gettime(CLOCK_MONOTONIC, &first);
+        auto *second_session = new Session(second_config);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (UCode::OK != session->getSuccess().code() || UCode::OK != second_session->getSuccess().code()) {
+            spdlog::error("ZenohUTransport init failed");
+            delete second_session;
+            delete session;
+            return;
+        }
+        sync_first.push_back(getDuration(first, start));
+        sync_second.push_back(getDuration(end, first));
+        sync_total.push_back(getDuration(end, start));
+        delete second_session;
+        delete session;
+        
+        uri_vec.clear();
+        attr_vec.clear();
+        
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        SessionPool::instance().prepare(config);
+        prepareAttributes(max_uri, uri_vec, attr_vec);
+        auto pooled = SessionPool::instance().acquire(config);
+        clock_gettime(CLOCK_MONOTONIC, &first);
+        auto second_pooled = SessionPool::instance().acquire(config);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (nullptr == pooled || nullptr == second_pooled) {
+            spdlog::error("ZenohUTransport init failed");
+            second_pooled.reset();
+            pooled.reset();
+            SessionPool::instance().clear();
+            return;
+        }
+        pool_first.push_back(getDuration(first, start));
+        pool_second.push_back(getDuration(end, first));
+        pool_total.push_back(getDuration(end, start));
+        second_pooled.reset();
+        pooled.reset();
+        SessionPool::instance().clear();
+    }
     
+    spdlog::info("{}", printHeader());
+    std::vector<std::pair<std::string, std::vector<double>*>> results {
+        {"sync first", &sync_first},
+        {"sync 2nd", &sync_second},
+        {"sync total", &sync_total},
+        {"pool first", &pool_first},
+        {"pool 2nd", &pool_second},
+        {"pool total", &pool_total}
+    };
+    for (auto &result : results) {
+        auto stat = getStats(*result.second);
+        if (stat.has_value()) {
+            spdlog::info("{}", printStat(result.first, stat.value()));
+        }
+        report.add(result.first, stat, result.second->size());
+    }
+}
+
+const std::string COLD_START_SHM = "/start_time.cold";
+const std::string COLD_START_PIPE = "[\"unixpipe/cold_start.pipe\"]";
+const std::string COLD_SUB = "cold-sub";
+const std::string COLD_APP = "cold-app";
+const std::string PROBE = "probe";
+const std::string DATA = "data";
+constexpr int COLD_START_LAUNCHES = 20;
+constexpr int PROBE_INTERVAL_US = 50;
+constexpr double COLD_START_TIMEOUT = 5.0;
+
+/**
+ * one cold launch, every phase is in seconds
+ * exec     - fork of the process until main() is running
+ * open     - ZenohUTransport constructor
+ * reg      - registerListener of the application own topic
+ * connect  - until the running subscriber got the first probe (route to the peer exists)
+ * publish  - send() of the first data message
+ * deliver  - send() start until the subscriber got the data message
+ * total    - fork until the subscriber got the data message
+ */
+struct cold_start_sample {
+    double exec;
+    double open;
+    double reg;
+    double connect;
+    double publish;
+    double deliver;
+    double total;
+    int status;
+};
+
+/**
+ * shared between the orchestrator, the subscriber that is already running and the
+ * application that is launched cold, all timestamps are CLOCK_MONOTONIC
+ */
+struct cold_start_shm {
+    std::atomic<int> sub_ready;
+    std::atomic<int> stop;
+    std::atomic<int> launch_id;
+    std::atomic<int> probe_seen;
+    std::atomic<int> data_seen;
+    struct timespec launch;
+    struct timespec data_rx;
+    cold_start_sample sample;
+};
+
+static inline auto openColdStartShm(bool create) -> cold_start_shm* {
+    int flags = create ? (O_CREAT | O_RDWR) : O_RDWR;
+    auto fd = shm_open(COLD_START_SHM.c_str(), flags, 0666);
+    if (-1 == fd) {
+        spdlog::error("Failed to open {} shered memory, {}", COLD_START_SHM, strerror(errno));
+        return nullptr;
+    }
+    if (create && ftruncate(fd, sizeof(cold_start_shm)) == -1) {
+        spdlog::error("Failed to size {} shered memory, {}", COLD_START_SHM, strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+    auto ptr = mmap(0, sizeof(cold_start_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == ptr) {
+        spdlog::error("Failed to map {} shered memory, {}", COLD_START_SHM, strerror(errno));
+        return nullptr;
+    }
+    if (create) {
+        std::memset(ptr, 0, sizeof(cold_start_shm));
+    }
+    return static_cast<cold_start_shm*>(ptr);
+}
+
+static inline auto now() -> struct timespec {
+    struct timespec tm{};
+    clock_gettime(CLOCK_MONOTONIC, &tm);
+    return tm;
+}
+
+static inline auto spawnSelf(const std::string& role, const std::vector<std::string>& args = {}) -> pid_t {
+    std::vector<std::string> str_argv {"/proc/self/exe", role};
+    str_argv.insert(str_argv.end(), args.begin(), args.end());
+    std::vector<char*> child_argv {};
+    for (auto& a : str_argv) {
+        child_argv.push_back(a.data());
+    }
+    child_argv.push_back(nullptr);
+    
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(child_argv[0], child_argv.data());
+        std::cerr << "failed to execute command : " << child_argv[0] << std::endl;
+        _exit(-1);
+    }
+    return pid;
+}
+
+/**
+ * the subscriber that is already running when the cold application starts
+ * it reports in the shared memory the probes and the first data message of each launch
+ */
+class ColdStartListener : public UListener {
+public:
+    explicit ColdStartListener(cold_start_shm *shm) : shm_(shm) {}
+    
+    UStatus onReceive(UMessage &umsg) override {
+        auto tm = now();
+        UStatus status;
+        auto payload = umsg.payload();
+        if (payload.isEmpty()) {
+            status.set_code(UCode::INVALID_ARGUMENT);
+            return status;
+        }
+        std::string data(reinterpret_cast<const char *>(payload.data()), payload.size());
+        std::string delimiter = "|";
+        auto split_data = split(data, delimiter);
+        if (split_data.size() < 2) {
+            status.set_code(UCode::INVALID_ARGUMENT);
+            return status;
+        }
+        char *endptr;
+        auto launch_id = std::strtol(split_data[1].c_str(), &endptr, 10);
+        if (launch_id != shm_->launch_id.load()) { // late message of previous launch
+            status.set_code(UCode::OK);
+            return status;
+        }
+        if (split_data[0] == PROBE) {
+            shm_->probe_seen.store(1);
+        } else if (split_data[0] == DATA && shm_->data_seen.load() == 0) {
+            shm_->data_rx = tm;
+            shm_->data_seen.store(1);
+        }
+        status.set_code(UCode::OK);
+        return status;
+    }
+
+private:
+    cold_start_shm *shm_;
+};
+
+/**
+ * the cold application own topic, it only exists to time registerListener
+ */
+class ColdAppListener : public UListener {
+public:
+    UStatus onReceive([[maybe_unused]] UMessage &umsg) override {
+        UStatus status;
+        status.set_code(UCode::OK);
+        return status;
+    }
+};
+
+static inline auto coldStartUri() -> UUri {
+    auto u_authority = BuildUAuthority().build();
+    auto u_entity = BuildUEntity().setId(100).setMajorVersion(1).build();
+    auto u_resource = BuildUResource().setID(100 << 3).build();
+    return BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
+}
+
+static inline auto coldAppUri() -> UUri {
+    auto u_authority = BuildUAuthority().build();
+    auto u_entity = BuildUEntity().setId(101).setMajorVersion(1).build();
+    auto u_resource = BuildUResource().setID(101 << 3).build();
+    return BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
+}
+
+auto cold_sub() -> int {
+    auto shm = openColdStartShm(false);
+    if (shm == nullptr) {
+        return -1;
+    }
+    ZenohSessionManagerConfig config{};
+    config.listenKey = COLD_START_PIPE;
+    config.connectKey = "";
+    config.qosEnabled = "false";
+    config.lowLatency = "true";
+    config.scouting_delay = 0;
+    
+    auto *session = new Session(config);
+    if (UCode::OK != session->getSuccess().code()) {
+        spdlog::error("ZenohUTransport init failed");
+        return -1;
+    }
+    
+    ColdStartListener listener(shm);
+    auto uri = coldStartUri();
+    auto status = session->registerListener(uri, listener);
+    if (UCode::OK != status.code()) {
+        spdlog::error("registerListener failed");
+        delete session;
+        return -1;
+    }
+    shm->sub_ready.store(1);
+    
+    while (shm->stop.load() == 0 && !terminate) {
+        usleep(1000);
+    }
+    
+    session->unregisterListener(uri, listener);
+    delete session;
+    munmap(shm, sizeof(cold_start_shm));
+    return 0;
+}
+
+static inline auto sendColdStart(Session *session, const UUri &uri, const std::string &kind, int launch_id, int msg_size) -> UStatus {
+    std::stringstream s;
+    s << kind << "|" << launch_id << "|";
+    auto len = s.str().size();
+    if (msg_size > static_cast<int>(len)) {
+        s << generateRandomString(msg_size - len);
+    }
+    auto data = s.str();
+    auto uuid = Uuidv8Factory::create();
+    UAttributesBuilder builder(uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
+    UAttributes attributes = builder.build();
+    UPayload payload((const uint8_t *)(data.c_str()), data.size(), UPayloadType::VALUE);
+    UMessage umsg(payload, attributes);
+    return session->send(umsg);
+}
+
+/**
+ * the application that is launched cold, every launch is a new process
+ */
+auto cold_app(int msg_size) -> int {
+    auto main_tm = now();
+    auto shm = openColdStartShm(false);
+    if (shm == nullptr) {
+        return -1;
+    }
+    auto &sample = shm->sample;
+    auto launch_id = shm->launch_id.load();
+    sample.status = -1;
+    sample.exec = getDuration(main_tm, shm->launch);
+    
+    ZenohSessionManagerConfig config{};
+    config.listenKey = "";
+    config.connectKey = COLD_START_PIPE;
+    config.qosEnabled = "false";
+    config.lowLatency = "true";
+    config.scouting_delay = 0;
+    
+    auto start = now();
+    auto *session = new Session(config);
+    auto end = now();
+    if (UCode::OK != session->getSuccess().code()) {
+        spdlog::error("ZenohUTransport init failed");
+        return -1;
+    }
+    sample.open = getDuration(end, start);
+    
+    ColdAppListener listener {};
+    auto app_uri = coldAppUri();
+    start = now();
+    auto status = session->registerListener(app_uri, listener);
+    end = now();
+    if (UCode::OK != status.code()) {
+        spdlog::error("registerListener failed");
+        delete session;
+        return -1;
+    }
+    sample.reg = getDuration(end, start);
+    
+    // messages sent before the route to the subscriber exists are lost, so probe until one arrives
+    auto uri = coldStartUri();
+    start = now();
+    while (shm->probe_seen.load() == 0) {
+        sendColdStart(session, uri, PROBE, launch_id, 0);
+        usleep(PROBE_INTERVAL_US);
+        end = now();
+        if (getDuration(end, start) > COLD_START_TIMEOUT) {
+            spdlog::error("no connection to the subscriber after {} seconds", COLD_START_TIMEOUT);
+            delete session;
+            return -1;
+        }
+    }
+    end = now();
+    sample.connect = getDuration(end, start);
+    
+    start = now();
+    status = sendColdStart(session, uri, DATA, launch_id, msg_size);
+    end = now();
+    if (UCode::OK != status.code()) {
+        spdlog::error("send.send failed");
+        delete session;
+        return -1;
+    }
+    sample.publish = getDuration(end, start);
+    
+    while (shm->data_seen.load() == 0) {
+        usleep(PROBE_INTERVAL_US);
+        end = now();
+        if (getDuration(end, start) > COLD_START_TIMEOUT) {
+            spdlog::error("first message was not delivered after {} seconds", COLD_START_TIMEOUT);
+            delete session;
+            return -1;
+        }
+    }
+    sample.deliver = getDuration(shm->data_rx, start);
+    sample.total = getDuration(shm->data_rx, shm->launch);
+    sample.status = 0;
+    
+    session->unregisterListener(app_uri, listener);
+    delete session;
+    munmap(shm, sizeof(cold_start_shm));
+    return 0;
+}
+
+/**
+ * launch the subscriber once and then the cold application launches times
+ * each launch is a new process so nothing is warm except the page cache
+ */
+auto cold_start(int launches, int msg_size, Report &report) -> int {
+    auto shm = openColdStartShm(true);
+    if (shm == nullptr) {
+        return -1;
+    }
+    
+    auto sub_pid = spawnSelf(COLD_SUB);
+    if (sub_pid < 0) {
+        spdlog::error("fork failed, {}", strerror(errno));
+        shm_unlink(COLD_START_SHM.c_str());
+        return -1;
+    }
+    auto start = now();
+    while (shm->sub_ready.load() == 0) {
+        usleep(1000);
+        auto tm = now();
+        if (getDuration(tm, start) > COLD_START_TIMEOUT) {
+            spdlog::error("subscriber is not ready after {} seconds", COLD_START_TIMEOUT);
+            kill(sub_pid, SIGTERM);
+            waitpid(sub_pid, nullptr, 0);
+            shm_unlink(COLD_START_SHM.c_str());
+            return -1;
+        }
+    }
+    
+    std::vector<double> exec_vec {};
+    std::vector<double> open_vec {};
+    std::vector<double> reg_vec {};
+    std::vector<double> connect_vec {};
+    std::vector<double> publish_vec {};
+    std::vector<double> deliver_vec {};
+    std::vector<double> total_vec {};
+    int failed = 0;
+    
+    for (auto i = 0; i < launches && !terminate; i++) {
+        shm->probe_seen.store(0);
+        shm->data_seen.store(0);
+        shm->sample = cold_start_sample{};
+        shm->sample.status = -1;
+        shm->launch_id.store(i + 1);
+        shm->launch = now();
+        auto pid = spawnSelf(COLD_APP, {std::to_string(msg_size)});
+        if (pid < 0) {
+            spdlog::error("fork failed, {}", strerror(errno));
+            break;
+        }
+        waitpid(pid, nullptr, 0);
+        
+        auto sample = shm->sample;
+        if (sample.status != 0) {
+            failed++;
+            continue;
+        }
+        exec_vec.push_back(sample.exec);
+        open_vec.push_back(sample.open);
+        reg_vec.push_back(sample.reg);
+        connect_vec.push_back(sample.connect);
+        publish_vec.push_back(sample.publish);
+        deliver_vec.push_back(sample.deliver);
+        total_vec.push_back(sample.total);
+    }
+    
+    shm->stop.store(1);
+    waitpid(sub_pid, nullptr, 0);
+    munmap(shm, sizeof(cold_start_shm));
+    shm_unlink(COLD_START_SHM.c_str());
+    
+    spdlog::info("cold start : {} launches, {} failed", launches, failed);
+    spdlog::info("{}", printHeader());
+    std::vector<std::pair<std::string, std::vector<double>*>> phases {
+        {"exec", &exec_vec},
+        {"open", &open_vec},
+        {"register", &reg_vec},
+        {"connect", &connect_vec},
+        {"publish", &publish_vec},
+        {"deliver", &deliver_vec},
+        {"total", &total_vec}
+    };
+    for (auto &phase : phases) {
+        auto count = phase.second->size();
+        auto stat = getStats(*phase.second);
+        if (stat.has_value()) {
+            spdlog::info("{}", printStat(phase.first, stat.value()));
+        }
+        auto row = makeReportRow(phase.first, stat, count);
+        row.lost = failed;
+        report.add(row);
+    }
+    return failed == 0 ? 0 : -1;
 }
 
 auto main(const int argc, char **argv) -> int {
@@ -143,6 +657,43 @@ auto main(const int argc, char **argv) -> int {
     int message_size = MESSAGE_SIZE;
     int max_uri = NUMBER_OF_MAX_URI;
     
+    // start_time cold [launches] [message size]
+    if (argc >= 2 && COLD_SUB == argv[1]) {
+        return cold_sub();
+    }
+    if (argc >= 3 && COLD_APP == argv[1]) {
+        char *endptr;
+        return cold_app(std::strtol(argv[2], &endptr, 10));
+    }
+    // start_time pool [loops] [number of uri]
+    if (argc >= 2 && std::string("pool") == argv[1]) {
+        char *endptr;
+        if (argc >= 3) {
+            loops = std::strtol(argv[2], &endptr, 10);
+        }
+        if (argc >= 4) {
+            max_uri = std::strtol(argv[3], &endptr, 10);
+        }
+        Report report("start_time pool");
+        pool_session(loops, max_uri, report);
+        report.write(getReportDir());
+        return 0;
+    }
+    if (argc >= 2 && std::string("cold") == argv[1]) {
+        int launches = COLD_START_LAUNCHES;
+        char *endptr;
+        if (argc >= 3) {
+            launches = std::strtol(argv[2], &endptr, 10);
+        }
+        if (argc >= 4) {
+            message_size = std::strtol(argv[3], &endptr, 10);
+        }
+        Report report("start_time cold");
+        auto res = cold_start(launches, message_size, report);
+        report.write(getReportDir());
+        return res;
+    }
+    
     if (argc >= 2) {
         char *endptr;
         loops = std::strtol(argv[1], &endptr, 10);
@@ -156,7 +707,9 @@ auto main(const int argc, char **argv) -> int {
         max_uri = std::strtol(argv[3], &endptr, 10);
     }
     
-    start_session(loops, message_size, max_uri);
+    Report report("start_time");
+    start_session(loops, message_size, max_uri, report);
+    report.write(getReportDir());
     return 0;
 }
 
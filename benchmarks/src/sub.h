@@ -29,6 +29,7 @@
 
 #include "utils.h"
 #include "filesys.h"
+#include "report.h"
 #include <spdlog/spdlog.h>
 
 using namespace uprotocol::utransport;
@@ -42,9 +43,10 @@ class CustomListener : public UListener {
 public:
     UStatus onReceive(UMessage &umsg) override {
         
-        auto attr = umsg.attributes();
+        // references, a copy of the attributes allocates the source and its strings for every message
+        const auto &attr = umsg.attributes();
         if (attr.has_source()) {
-            auto source = attr.source();
+            const auto &source = attr.source();
             auto empty = isEmpty(source);
             if (empty) {
                 std::cout << "got message" << __func__ << ":" << __LINE__ << " source is empty" << empty << std::endl;
@@ -78,7 +80,7 @@ public:
     
 };
 
-auto sub(const int loops, int num_of_uri) -> int {
+auto sub(const int loops, int num_of_uri, Report &report) -> int {
     std::vector<SubListener> subscription {};
     CustomListener listener {};
     for (auto i = 0; i < num_of_uri; i++) {
@@ -141,11 +143,207 @@ auto sub(const int loops, int num_of_uri) -> int {
     auto start_sub_stat = getStats(subscribe);
     auto close_sub_stat = getStats(unsubscribe);
     spdlog::info("{}", printHeader());
-    spdlog::info("{}", printStat("subscribe", start_sub_stat.value()));
-    spdlog::info("{}", printStat("unsubscribe", close_sub_stat.value()));
+    if (start_sub_stat.has_value()) {
+        spdlog::info("{}", printStat("subscribe", start_sub_stat.value()));
+    }
+    if (close_sub_stat.has_value()) {
+        spdlog::info("{}", printStat("unsubscribe", close_sub_stat.value()));
+    }
+    report.add("subscribe", start_sub_stat, subscribe.size());
+    report.add("unsubscribe", close_sub_stat, unsubscribe.size());
     
     return 0;
 }
 
+constexpr int CHURN_NUMBER_OF_URI = 10000;
+constexpr int CHURN_BUCKETS = 10;
+constexpr int CHURN_SEED = 42;
+
+struct churn_sample {
+    size_t live;
+    double duration;
+};
+
+/**
+ * least squares slope of the duration as function of the number of live subscriptions
+ * a flat registration path is close to 0, an O(n) path grows with every subscription
+ */
+static inline auto getChurnSlope(const std::vector<churn_sample> &samples) -> std::optional<double> {
+    if (samples.size() < 2) {
+        return std::nullopt;
+    }
+    double n = samples.size();
+    double sum_x = 0;
+    double sum_y = 0;
+    double sum_xy = 0;
+    double sum_xx = 0;
+    for (auto const &e : samples) {
+        sum_x += e.live;
+        sum_y += e.duration;
+        sum_xy += e.live * e.duration;
+        sum_xx += static_cast<double>(e.live) * e.live;
+    }
+    auto denominator = n * sum_xx - sum_x * sum_x;
+    if (denominator == 0) {
+        return std::nullopt;
+    }
+    return (n * sum_xy - sum_x * sum_y) / denominator;
+}
+
+/**
+ * print the latency per bucket of live subscriptions, each bucket is max_live / CHURN_BUCKETS wide
+ */
+static inline auto printChurn(const std::string &name, const std::vector<churn_sample> &samples, size_t max_live, Report &report) -> void {
+    std::vector<std::vector<double>> buckets(CHURN_BUCKETS);
+    size_t width = std::max<size_t>(1, (max_live + CHURN_BUCKETS - 1) / CHURN_BUCKETS);
+    for (auto const &e : samples) {
+        auto bucket = std::min<size_t>(e.live / width, CHURN_BUCKETS - 1);
+        buckets[bucket].push_back(e.duration);
+    }
+    for (size_t i = 0; i < buckets.size(); i++) {
+        auto count = buckets[i].size();
+        auto stat = getStats(buckets[i]);
+        if (stat.has_value()) {
+            spdlog::info("{}", printStat(name.substr(0, 1) + "@" + std::to_string((i + 1) * width), stat.value()));
+        }
+        auto row = makeReportRow(name + "@" + std::to_string((i + 1) * width), stat, count);
+        row.extra.emplace_back("live", (i + 1) * width);
+        report.add(row);
+    }
+    auto slope = getChurnSlope(samples);
+    if (slope.has_value()) {
+        spdlog::info("{} : {:.3f} ns per 1000 live subscriptions", name, slope.value() * 1.0e12);
+        auto row = makeReportRow(name + " slope", std::nullopt, samples.size());
+        row.extra.emplace_back("ns_per_1000_live", slope.value() * 1.0e12);
+        report.add(row);
+    }
+}
+
+/**
+ * register and unregister thousands of topics
+ * ramp        - register all the URIs one after the other
+ * interleaved - register and unregister random URIs (seeded) while about half of them are live
+ * drain       - unregister all the live URIs in random order
+ * the latency is reported per number of live subscriptions with the memory per subscription
+ */
+auto sub_churn(int num_of_uri, int churn_ops, Report &report) -> int {
+    auto uri_vec = createVectorofUUri(num_of_uri);
+    CustomListener listener {};
+    
+    ZenohSessionManagerConfig config{};
+    auto *transport = new Subscriber(config);
+    if (UCode::OK != (transport->getSuccess()).code()) {
+        spdlog::error("ZenohUTransport init failed");
+        return -1;
+    }
+    
+    std::vector<churn_sample> subscribe {};
+    std::vector<churn_sample> unsubscribe {};
+    subscribe.reserve(num_of_uri + churn_ops);
+    unsubscribe.reserve(num_of_uri + churn_ops);
+    
+    // live holds the indexes of the registered URIs, position the index of each URI in live
+    std::vector<size_t> live {};
+    std::vector<long> position(num_of_uri, -1);
+    live.reserve(num_of_uri);
+    
+    auto doRegister = [&](size_t index) -> bool {
+        struct timespec start{};
+        struct timespec end{};
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        auto status = transport->registerListener(uri_vec[index], listener);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (UCode::OK != status.code()) {
+            spdlog::error("registerListener failed for {}", convertSerializedURItoString(MicroUriSerializer::serialize(uri_vec[index])));
+            return false;
+        }
+        subscribe.push_back({live.size(), getDuration(end, start)});
+        position[index] = live.size();
+        live.push_back(index);
+        return true;
+    };
+    
+    auto doUnregister = [&](size_t index) -> bool {
+        struct timespec start{};
+        struct timespec end{};
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        auto status = transport->unregisterListener(uri_vec[index], listener);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (UCode::OK != status.code()) {
+            spdlog::error("unregisterListener failed for {}", convertSerializedURItoString(MicroUriSerializer::serialize(uri_vec[index])));
+            return false;
+        }
+        unsubscribe.push_back({live.size(), getDuration(end, start)});
+        auto pos = position[index];
+        live[pos] = live.back();
+        position[live[pos]] = pos;
+        live.pop_back();
+        position[index] = -1;
+        return true;
+    };
+    
+    std::mt19937 rnd_gen(CHURN_SEED);
+    
+    auto rss_before = getResidentMemory();
+    for (auto i = 0; i < num_of_uri; i++) {
+        if (!doRegister(i)) {
+            delete transport;
+            return -1;
+        }
+    }
+    auto rss_after = getResidentMemory();
+    
+    // interleaved, drop to half of the URIs and then keep it around half
+    for (auto i = 0; i < churn_ops && !terminate; i++) {
+        bool unregister_op = live.size() > static_cast<size_t>(num_of_uri / 2) ? (rnd_gen() % 4 != 0) : (rnd_gen() % 4 == 0);
+        if (live.empty()) {
+            unregister_op = false;
+        }
+        if (live.size() == static_cast<size_t>(num_of_uri)) {
+            unregister_op = true;
+        }
+        if (unregister_op) {
+            if (!doUnregister(live[rnd_gen() % live.size()])) {
+                delete transport;
+                return -1;
+            }
+        } else {
+            size_t index = rnd_gen() % num_of_uri;
+            while (position[index] != -1) {
+                index = (index + 1) % num_of_uri;
+            }
+            if (!doRegister(index)) {
+                delete transport;
+                return -1;
+            }
+        }
+    }
+    
+    std::shuffle(live.begin(), live.end(), rnd_gen);
+    for (size_t i = 0; i < live.size(); i++) {
+        position[live[i]] = i;
+    }
+    while (!live.empty()) {
+        if (!doUnregister(live.back())) {
+            delete transport;
+            return -1;
+        }
+    }
+    
+    delete transport;
+    
+    spdlog::info("churn : {} URIs, {} interleaved operations, seed {}", num_of_uri, churn_ops, CHURN_SEED);
+    if (rss_before > 0 && rss_after > 0 && num_of_uri > 0) {
+        spdlog::info("memory per subscription : {} bytes", (rss_after - rss_before) / num_of_uri);
+        auto row = makeReportRow("memory", std::nullopt, num_of_uri);
+        row.extra.emplace_back("bytes_per_subscription", (rss_after - rss_before) / num_of_uri);
+        report.add(row);
+    }
+    spdlog::info("{}", printHeader());
+    printChurn("subscribe", subscribe, num_of_uri, report);
+    printChurn("unsubscribe", unsubscribe, num_of_uri, report);
+    
+    return 0;
+}
 
 #endif //UP_ZENOH_EXAMPLE_CPP_SUB_H
@@ -23,10 +23,19 @@
 //  *
 //
 
+#include <atomic>
+#include <mutex>
+
 #include <spdlog/spdlog.h>
 
 #include "utils.h"
 #include "filesys.h"
+#include "test_plan.h"
+#include "window.h"
+#include "tail.h"
+#include "alloc_trace.h"
+#include "ShardedReceiver.h"
+#include "Trace.h"
 
 
 using namespace uprotocol::utransport;
@@ -34,20 +43,85 @@ using namespace uprotocol::uri;
 using namespace uprotocol::v1;
 using namespace uprotocol::uuid;
 
+/**
+ * the allocations of the receive path, what the callback thread allocates between the end of a callback and the
+ * start of the next one is the transport delivering the message, the callback itself is not counted.
+ * the first tenth of the expected messages is not counted
+ */
+struct alloc_state {
+    auto enter() -> void {
+        auto now = allocTraceThread();
+        auto received = received_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (received == steady_from) {
+            process_start = allocTraceProcess();
+        }
+        if (received >= steady_from && has_exit_) {
+            allocAdd(thread, allocDelta(now, last_exit_));
+        }
+    }
+
+    auto exit() -> void {
+        last_exit_ = allocTraceThread();
+        has_exit_ = true;
+    }
+
+    auto messages() const -> uint64_t {
+        auto received = received_.load(std::memory_order_relaxed);
+        return received > steady_from ? received - steady_from : 0;
+    }
+
+    uint64_t steady_from = 0;
+    alloc_counters thread {};
+    alloc_counters process_start {};
+    std::mutex mutex {};
+
+private:
+    std::atomic<uint64_t> received_ {0};
+    static inline thread_local alloc_counters last_exit_ {};
+    static inline thread_local bool has_exit_ = false;
+};
+
 class CustomListener : public UListener {
 public:
     UStatus onReceive(UMessage &umsg) override {
+        TraceScope trace_callback("callback");
+        if (!allocTraceEnabled() || alloc == nullptr) {
+            return handle(umsg);
+        }
+        alloc->enter();
+        auto status = handle(umsg);
+        alloc->exit();
+        return status;
+    }
+
+    auto handle(UMessage &umsg) -> UStatus {
+        auto payload = umsg.payload();
+        // with shards the callback only copies the payload, process() runs on the worker of the topic
+        if (receiver != nullptr) {
+            TraceScope trace_enqueue("enqueue");
+            receiver->push(key, payload.data(), payload.size());
+            UStatus status;
+            status.set_code(UCode::OK);
+            return status;
+        }
+        return process(payload.data(), payload.size());
+    }
+
+    /**
+     * the latency is taken here so with shards it includes the time in the queue
+     */
+    auto process(const uint8_t *p, size_t size) -> UStatus {
+        TraceScope trace_process("process");
         UStatus status;
         char *endptr;
         struct timespec tm{};
         clock_gettime(CLOCK_MONOTONIC, &tm);
-        auto payload = umsg.payload();
-        if (payload.isEmpty()) {
+        if (size == 0) {
             //spdlog::error("Payload is empty");
             status.set_code(UCode::INVALID_ARGUMENT);
             return status;
         }
-        auto p = reinterpret_cast<const uint8_t *>(payload.data());
         std::string data = std::string((char *)p);
     
         std::string delimiter = "|";
@@ -80,7 +154,19 @@ public:
         //calculate duration
     
         auto duration = getDuration(tm, sent_time);
+        // the end of the arrow from the send of the publisher
+        if (Tracer::enabled() && split_data.size() > 2) {
+            traceFlow("message", traceMessageId(std::strtoul(split_data[2].c_str(), &endptr, 10), TestPlan::topicIndex(entity_id, resource_id),
+                                                std::strtoul(split_data[1].c_str(), &endptr, 10)), false);
+        }
         duration_vec.push_back(duration);
+        rx_vec.push_back(tm);
+        // the sequence and the publisher are parsed only for the samples that are kept
+        if (tail != nullptr && tail->isTail(duration) && split_data.size() > 2) {
+            tail->record({duration, static_cast<uint32_t>(std::strtoul(split_data[2].c_str(), &endptr, 10)),
+                          entity_id, resource_id, std::strtoull(split_data[1].c_str(), &endptr, 10),
+                          sent_time, tm, {}, 0, 0});
+        }
         count_arraived++;
         messeges_size += data.size();
     
@@ -115,6 +201,13 @@ public:
     long messeges_size = 0;
 //    int missed_messages = 0;
     std::vector<double> duration_vec {};
+    std::vector<struct timespec> rx_vec {}; // receive time of every duration, for the windows
+    TailRecorder *tail = nullptr; // shared by all the listeners of the process
+    alloc_state *alloc = nullptr; // shared by all the listeners of the process
+    ShardedReceiver *receiver = nullptr; // shared by all the listeners of the process when the plan has shards
+    uint32_t key = 0; // index of the listener, the shard is a hash of it
+    uint32_t entity_id = 0;
+    uint32_t resource_id = 0;
     long counter = 0;
 
 private:
@@ -144,29 +237,32 @@ public :
 };
 
 
+// sub_test <app> <test plan>
 auto main(const int argc, char **argv) -> int {
 //    std::signal(SIGINT, signalHandler);
 //    std::signal(SIGTERM, signalHandler);
 //    std::signal(SIGABRT, signalHandler);
+    if (argc < 3) {
+        std::cout << "usage : " << argv[0] << " <app> <test plan>" << std::endl;
+        return -1;
+    }
+    TestPlan plan {};
+    if (plan.open(argv[2]) != 0) {
+        return -1;
+    }
+    auto app = plan.app(argv[1]);
+    if (app == nullptr || app->role != plan_role::SUBSCRIBER) {
+        spdlog::error("{} is not a subscriber of the test plan", argv[1]);
+        return -1;
+    }
     
-    auto dir = getWorkingDir();
+    auto dir = plan.workingDir();
     std::string file_name = "sub-" + (std::string)argv[1];
-    auto path = dir / file_name;
-    //std::cout << path << std::endl;
-//    auto p_id = getpid(); 
-//    auto num_messages = getEnvNumberOfMessages();
-    
-    std::vector<std::string> uri_str = getUristr(argc,  argv);
+    if (Tracer::enabledByEnv()) {
+        Tracer::instance().enable();
+    }
     
     std::vector<std::unique_ptr<CustomListener>> listeners;
-    UUri* uris = new UUri[uri_str.size()];
-    
-   
-    for (ulong i = 0; i < uri_str.size(); i++) {
-        auto str = uri_str[getRandomInRange(0, uri_str.size() - 1)];
-        auto vec = convertHexStringToUint8Vec(str);
-        uris[i] = MicroUriSerializer::deserialize(vec);
-    }
     
     std::vector<shm_data> shm_vec;
     if (createSheredMem((std::string(argv[0])), std::string(argv[1]), shm_vec) != 0) {
@@ -185,7 +281,7 @@ auto main(const int argc, char **argv) -> int {
     }
 
     ZenohSessionManagerConfig config{};
-    auto list_of_servers = createServerPortlist(MAX_PROCESS);
+    auto list_of_servers = createServerPortlist(plan.topology(), plan.locator());
     auto listen_key = list_of_servers[std::string(argv[1])].second;
     //auto listen_key = getAllPubKeys(list_of_servers);
     std::cout << "listening on : " << listen_key << "for : " << argv[1] <<  std::endl;
@@ -209,22 +305,34 @@ auto main(const int argc, char **argv) -> int {
 //    std::cout << __func__ << ":" <<  __LINE__ << ":  " << argv[0] << ":" << argv[1] << std::endl;
 
     std::vector<UUri> subscription;
-//    auto number_of_subscribers = getRandomInRange(4, uri_str.size() - 1);
-//    for (auto i = 0; i < number_of_subscribers; i++) {
-//        auto uri = uris[getRandomInRange(0, uri_str.size() - 1)];
-//        subscription.push_back(uri);
-//        listeners.emplace_back(std::make_unique<CustomListener>());
-//    }
-    
-    for (ulong i = 0; i < uri_str.size(); i++) {
-        subscription.push_back(uris[i]);
+    TailRecorder tail(plan.header()->tail_threshold_us * 1.0e-6, plan.header()->tail_capacity);
+    alloc_state alloc {};
+    // every subscriber listens to the topics of the plan so all the subscribers of a fan-out get the same messages
+    for (auto topic : plan.topics(*app)) {
+        subscription.push_back(TestPlan::buildUri(*topic));
         listeners.emplace_back(std::make_unique<CustomListener>());
+        listeners.back()->tail = &tail;
+        listeners.back()->alloc = &alloc;
+        listeners.back()->entity_id = topic->entity_id;
+        listeners.back()->resource_id = topic->resource_id;
     }
-         
+    alloc.steady_from = static_cast<uint64_t>(plan.header()->loops) * subscription.size() / 10;
+    // with shards the callbacks only enqueue, the listeners are run by the pinned workers (see ShardedReceiver.h)
+    std::unique_ptr<ShardedReceiver> receiver {};
+    if (plan.header()->recv_shards > 0) {
+        receiver = std::make_unique<ShardedReceiver>(plan.header()->recv_shards, [&listeners](const received_message &msg) {
+            listeners[msg.key]->process(msg.data, msg.size);
+        });
+        for (size_t i = 0; i < listeners.size(); i++) {
+            listeners[i]->receiver = receiver.get();
+            listeners[i]->key = i;
+        }
+        receiver->start();
+    }
+        
         //CustomListener listener {};
     auto listener = std::make_unique<CustomListener>();
     for (size_t i = 0; i < subscription.size(); i++) {
-        //auto entry = getRandomInRange(0, uri_str.size() - 1);
         auto status = transport->registerListener(subscription[i], *listeners[i]);
 //        std::cout << __func__ << ":" <<  __LINE__ << ":  " << argv[0] << ":" << argv[1] << std::endl;
         if (UCode::OK != status.code()){
@@ -256,14 +364,7 @@ auto main(const int argc, char **argv) -> int {
         usleep(100);
     }
     std::cout << __func__ << ":" <<  __LINE__ << ":  " << argv[0] << ":" << argv[1] << " exit start stat" << std::endl;
-    
-    for (size_t i = 0; i < subscription.size(); i++) {
-        std::cout << argv[0] << ":" << argv[1] << " " << (*listeners[i]).count_arraived << " total messages = " << (*listeners[i]).messeges_size << "\n";
-        if ((*listeners[i]).duration_vec.size() > 0) {
-            writeVecToFile(path, (*listeners[i]).duration_vec);
-        }
-    }
-    
+    // no callback after the listeners are unregistered, the shards then only drain what was already pushed
     for (size_t i = 0; i < subscription.size(); i++) {
         auto status = transport->unregisterListener(subscription[i], *listeners[i]);
         if (UCode::OK != status.code()){
@@ -274,6 +375,43 @@ auto main(const int argc, char **argv) -> int {
             return -1;
         }
     }
+    if (receiver != nullptr) {
+        receiver->stop();
+        for (auto const &m : receiver->metrics()) {
+            spdlog::info("{} : shard on cpu {}{} : {} messages, queue delay mean {:.9f} max {:.9f}, max depth {}, {} waits on a full queue, {} dropped",
+                         file_name, m.cpu, m.pinned ? "" : " (not pinned)", m.processed, m.delay_mean, m.delay_max,
+                         m.max_depth, m.full, m.dropped);
+        }
+    }
+    if (allocTraceEnabled() && alloc.messages() > 0) {
+        auto alloc_end = allocTraceProcess();
+        std::lock_guard<std::mutex> lock(alloc.mutex);
+        writeAllocTrace(dir, file_name, alloc.messages(), alloc.thread, allocDelta(alloc_end, alloc.process_start));
+    }
+    
+    // all the topics of the process in one series, the warm-up is written apart from the steady state
+    WindowSeries series(plan.header()->window_us * 1.0e-6);
+    for (size_t i = 0; i < subscription.size(); i++) {
+        std::cout << argv[0] << ":" << argv[1] << " " << (*listeners[i]).count_arraived << " total messages = " << (*listeners[i]).messeges_size << "\n";
+        for (size_t j = 0; j < (*listeners[i]).duration_vec.size(); j++) {
+            series.add((*listeners[i]).rx_vec[j], (*listeners[i]).duration_vec[j]);
+        }
+    }
+    writeSeries(dir, file_name, series);
+    spdlog::info("{} : {} windows, warm-up {:.3f} seconds ({} samples)", file_name, series.windows().size(),
+                 series.warmupSeconds(), series.warmup().size());
+    writeTail(dir, file_name, tail);
+    // the callbacks and the shard workers are done, the rings of their threads are not written anymore
+    if (Tracer::enabled()) {
+        Tracer::instance().disable();
+        if (!Tracer::instance().write(dir / (TRACE_PREFIX + file_name + ".json"), file_name)) {
+            spdlog::error("{} : failed to write the trace", file_name);
+        }
+        if (auto overwritten = Tracer::instance().overwritten(); overwritten > 0) {
+            spdlog::warn("{} : the trace lost its {} oldest events", file_name, overwritten);
+        }
+    }
+    
     
     std::cout << __func__ << ":" <<  __LINE__ << ":  " << argv[0] << ":" << argv[1] << std::endl;
     delete transport;
@@ -0,0 +1,201 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_TAIL_H
+#define UP_ZENOH_EXAMPLE_CPP_TAIL_H
+
+#include "utils.h"
+#include "filesys.h"
+#include <atomic>
+#include <mutex>
+#include <sched.h>
+#include <sys/syscall.h>
+
+constexpr uint32_t TAIL_CAPACITY = 1000;
+constexpr uint32_t TAIL_THRESHOLD_US = 0; // 0 keeps the TAIL_CAPACITY slowest samples
+const std::string TAIL_PREFIX = "tail-";
+
+/**
+ * the context of one slow sample
+ */
+struct tail_event {
+    double duration;
+    uint32_t publisher; // app index of the publisher
+    uint32_t entity_id;
+    uint32_t resource_id;
+    uint64_t sequence;
+    struct timespec sent; // CLOCK_MONOTONIC
+    struct timespec received;
+    struct timespec wall; // CLOCK_REALTIME of received, to line up with the system logs
+    pid_t tid;
+    int cpu;
+};
+
+static inline auto isTailBefore(const tail_event &lhs, const tail_event &rhs) -> bool {
+    return lhs.duration > rhs.duration;
+}
+
+/**
+ * keeps the slow samples of a process, a ring of the last capacity samples above the threshold
+ * or, with threshold 0, the capacity slowest samples of the run (top-K)
+ * the check of a sample that is not kept is a relaxed load, the lock is taken only to keep one
+ */
+class TailRecorder {
+public:
+    TailRecorder(double threshold, size_t capacity) : threshold_(threshold), capacity_(std::max<size_t>(1, capacity)) {
+        events_.reserve(capacity_);
+        floor_.store(threshold_, std::memory_order_relaxed);
+        struct timespec mono{};
+        struct timespec real{};
+        clock_gettime(CLOCK_REALTIME, &real);
+        clock_gettime(CLOCK_MONOTONIC, &mono);
+        wall_offset_ = getDuration(real, mono);
+    }
+
+    inline auto isTail(double duration) const -> bool {
+        return duration > floor_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * fill the thread, cpu and wall clock of the event and keep it
+     */
+    auto record(tail_event event) -> void {
+        event.tid = static_cast<pid_t>(syscall(SYS_gettid));
+        event.cpu = sched_getcpu();
+        auto wall = (double)event.received.tv_sec + (double)event.received.tv_nsec * 1.0e-9 + wall_offset_;
+        event.wall.tv_sec = static_cast<time_t>(wall);
+        event.wall.tv_nsec = static_cast<long>((wall - (double)event.wall.tv_sec) * 1.0e9);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        seen_++;
+        if (threshold_ > 0) {
+            if (events_.size() < capacity_) {
+                events_.push_back(event);
+            } else {
+                events_[next_] = event;
+            }
+            next_ = (next_ + 1) % capacity_;
+            return;
+        }
+        // min heap on the duration, the root is the fastest of the kept samples
+        if (events_.size() < capacity_) {
+            events_.push_back(event);
+            std::push_heap(events_.begin(), events_.end(), isTailBefore);
+        } else if (event.duration > events_.front().duration) {
+            std::pop_heap(events_.begin(), events_.end(), isTailBefore);
+            events_.back() = event;
+            std::push_heap(events_.begin(), events_.end(), isTailBefore);
+        }
+        if (events_.size() == capacity_) {
+            floor_.store(events_.front().duration, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * the kept events, slowest first
+     */
+    auto events() -> std::vector<tail_event> {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto res = events_;
+        std::sort(res.begin(), res.end(), [](const tail_event &lhs, const tail_event &rhs) {
+            return lhs.duration > rhs.duration;
+        });
+        return res;
+    }
+
+    inline auto seen() -> size_t {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return seen_;
+    }
+
+private:
+    double threshold_;
+    size_t capacity_;
+    double wall_offset_ = 0;
+    std::atomic<double> floor_ {0};
+    std::mutex mutex_ {};
+    std::vector<tail_event> events_ {};
+    size_t next_ = 0;
+    size_t seen_ = 0;
+};
+
+static inline auto formatWallClock(const struct timespec &tm) -> std::string {
+    std::tm local_time {};
+    localtime_r(&tm.tv_sec, &local_time);
+    std::stringstream s;
+    s << std::put_time(&local_time, "%Y-%m-%dT%H:%M:%S") << "." << std::setw(9) << std::setfill('0') << tm.tv_nsec;
+    return s.str();
+}
+
+static inline auto tailHeader() -> std::string {
+    return "app,duration,publisher,entity_id,resource_id,sequence,sent,received,wall_clock,tid,cpu";
+}
+
+static inline auto tailToCsv(const std::string &app, const tail_event &e) -> std::string {
+    std::stringstream s;
+    s << std::fixed << std::setprecision(9);
+    s << app << "," << e.duration << "," << e.publisher << "," << e.entity_id << "," << e.resource_id << ","
+      << e.sequence << "," << (double)e.sent.tv_sec + (double)e.sent.tv_nsec * 1.0e-9 << ","
+      << (double)e.received.tv_sec + (double)e.received.tv_nsec * 1.0e-9 << ","
+      << formatWallClock(e.wall) << "," << e.tid << "," << e.cpu;
+    return s.str();
+}
+
+/**
+ * write the events of the process to tail-<file_name>.csv in dir, slowest first
+ */
+static inline auto writeTail(const std::filesystem::path &dir, const std::string &file_name, TailRecorder &tail) -> int {
+    std::stringstream s;
+    s << tailHeader() << "\n";
+    for (auto const &e : tail.events()) {
+        s << tailToCsv(file_name, e) << "\n";
+    }
+    return writeFileAtomic(dir / (TAIL_PREFIX + file_name + ".csv"), s.str());
+}
+
+/**
+ * the lines of the tail files of a run merged into one, slowest first
+ */
+static inline auto mergeTails(const std::vector<std::filesystem::path> &files) -> std::vector<std::pair<double, std::string>> {
+    std::vector<std::pair<double, std::string>> res {};
+    for (auto const &file : files) {
+        std::ifstream input_file(file);
+        std::string line {};
+        std::getline(input_file, line); // header
+        while (std::getline(input_file, line)) {
+            auto comma = line.find(',');
+            if (comma == std::string::npos) {
+                continue;
+            }
+            res.emplace_back(std::strtod(line.c_str() + comma + 1, nullptr), line);
+        }
+    }
+    std::sort(res.begin(), res.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.first > rhs.first;
+    });
+    return res;
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_TAIL_H
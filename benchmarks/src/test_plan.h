@@ -0,0 +1,306 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_TEST_PLAN_H
+#define UP_ZENOH_EXAMPLE_CPP_TEST_PLAN_H
+
+#include "utils.h"
+#include "filesys.h"
+#include <sys/stat.h>
+
+constexpr uint32_t TEST_PLAN_MAGIC = 0x50545055; // "UPTP"
+constexpr uint32_t TEST_PLAN_VERSION = 4;
+constexpr uint32_t TEST_PLAN_MAX_TOPICS = 4096 * 16; // 16 entities of 4096 resources (see createVectorofUUri)
+constexpr uint64_t TEST_PLAN_SEED = 42;
+constexpr uint32_t TEST_PLAN_PERIOD_US = 10;
+constexpr size_t TEST_PLAN_NAME_SIZE = 32;
+constexpr size_t TEST_PLAN_PATH_SIZE = 256;
+
+enum class plan_role : uint32_t {
+    PUBLISHER = 0,
+    SUBSCRIBER = 1
+};
+
+/**
+ * the binary test plan, one shared memory segment written once by run_tests and mapped read only by the children
+ * | header | apps[num_apps] | topics[num_topics] | assignments[num_assignments] |
+ * an assignment is the index of a topic, every app owns num_assignments of them from first_assignment
+ */
+struct test_plan_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    uint64_t seed;
+    uint32_t loops; // messages per topic
+    uint32_t pubs;
+    uint32_t subs;
+    uint32_t num_apps;
+    uint32_t num_topics;
+    uint32_t num_assignments;
+    uint32_t window_us; // width of the latency windows (see window.h)
+    uint32_t tail_threshold_us; // slow samples kept with their context (see tail.h), 0 is the slowest tail_capacity
+    uint32_t tail_capacity;
+    uint32_t recv_shards; // workers behind the listeners of a subscriber (see ShardedReceiver.h), 0 runs them on the transport thread
+    uint64_t apps_offset;
+    uint64_t topics_offset;
+    uint64_t assignments_offset;
+    char locator[TEST_PLAN_NAME_SIZE];
+    char working_dir[TEST_PLAN_PATH_SIZE];
+};
+
+struct test_plan_app {
+    char name[TEST_PLAN_NAME_SIZE];
+    plan_role role;
+    uint32_t index;
+    uint32_t first_assignment;
+    uint32_t num_assignments;
+};
+
+struct test_plan_topic {
+    uint32_t entity_id;
+    uint32_t resource_id;
+    uint32_t message_size;
+    uint32_t period_us;
+};
+
+struct test_plan_config {
+    uint64_t seed;
+    uint32_t loops;
+    uint32_t message_size;
+    uint32_t period_us;
+    uint32_t num_topics;
+    uint32_t window_us;
+    uint32_t tail_threshold_us;
+    uint32_t tail_capacity;
+    uint32_t recv_shards;
+    topology_s topology;
+    std::string locator;
+    std::string working_dir;
+};
+
+static inline auto copyPlanString(char *dst, size_t size, const std::string &src) -> bool {
+    if (src.size() >= size) {
+        return false;
+    }
+    std::memset(dst, 0, size);
+    std::memcpy(dst, src.c_str(), src.size());
+    return true;
+}
+
+static inline auto getTestPlanName() -> std::string {
+    return "/run_tests.plan." + std::to_string(getpid());
+}
+
+/**
+ * write the plan of a scenario to the shared memory segment shm_name
+ * app0 .. app(pubs - 1) publish, the rest subscribe (the same names as createServerPortlist),
+ * every app gets all the topics in its own order shuffled with the seed so the same seed is the same run
+ */
+static inline auto createTestPlan(const std::string &shm_name, const test_plan_config &config) -> int {
+    if (config.num_topics == 0 || config.num_topics > TEST_PLAN_MAX_TOPICS) {
+        spdlog::error("test plan : {} topics, expected 1 to {}", config.num_topics, TEST_PLAN_MAX_TOPICS);
+        return -1;
+    }
+    uint32_t num_apps = config.topology.pubs + config.topology.subs;
+    uint32_t num_assignments = num_apps * config.num_topics;
+    test_plan_header header {};
+    header.magic = TEST_PLAN_MAGIC;
+    header.version = TEST_PLAN_VERSION;
+    header.seed = config.seed;
+    header.loops = config.loops;
+    header.pubs = config.topology.pubs;
+    header.subs = config.topology.subs;
+    header.num_apps = num_apps;
+    header.num_topics = config.num_topics;
+    header.num_assignments = num_assignments;
+    header.window_us = config.window_us;
+    header.tail_threshold_us = config.tail_threshold_us;
+    header.tail_capacity = config.tail_capacity;
+    header.recv_shards = config.recv_shards;
+    header.apps_offset = sizeof(test_plan_header);
+    header.topics_offset = header.apps_offset + num_apps * sizeof(test_plan_app);
+    header.assignments_offset = header.topics_offset + config.num_topics * sizeof(test_plan_topic);
+    header.size = header.assignments_offset + num_assignments * sizeof(uint32_t);
+    if (!copyPlanString(header.locator, sizeof(header.locator), config.locator) ||
+        !copyPlanString(header.working_dir, sizeof(header.working_dir), config.working_dir)) {
+        spdlog::error("test plan : locator or working directory too long");
+        return -1;
+    }
+
+    shm_unlink(shm_name.c_str());
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (-1 == fd) {
+        spdlog::error("Failed to open {} shered memory, {}", shm_name, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(fd, header.size) != 0) {
+        spdlog::error("Failed to resize {} shered memory, {}", shm_name, strerror(errno));
+        close(fd);
+        shm_unlink(shm_name.c_str());
+        return -1;
+    }
+    auto ptr = static_cast<uint8_t*>(mmap(nullptr, header.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+    if (MAP_FAILED == ptr) {
+        spdlog::error("Failed to map {} shered memory, {}", shm_name, strerror(errno));
+        shm_unlink(shm_name.c_str());
+        return -1;
+    }
+
+    std::mt19937_64 rnd_gen(config.seed);
+    auto topics = reinterpret_cast<test_plan_topic*>(ptr + header.topics_offset);
+    for (uint32_t i = 0; i < config.num_topics; i++) {
+        topics[i].entity_id = (i >> 12) + 1;
+        topics[i].resource_id = ((i & 0xfff) + 1) << 3;
+        topics[i].message_size = config.message_size;
+        topics[i].period_us = config.period_us;
+    }
+    auto apps = reinterpret_cast<test_plan_app*>(ptr + header.apps_offset);
+    auto assignments = reinterpret_cast<uint32_t*>(ptr + header.assignments_offset);
+    std::vector<uint32_t> order(config.num_topics);
+    std::iota(order.begin(), order.end(), 0);
+    for (uint32_t i = 0; i < num_apps; i++) {
+        std::memset(&apps[i], 0, sizeof(test_plan_app));
+        copyPlanString(apps[i].name, sizeof(apps[i].name), "app" + std::to_string(i));
+        apps[i].role = (i < header.pubs) ? plan_role::PUBLISHER : plan_role::SUBSCRIBER;
+        apps[i].index = i;
+        apps[i].first_assignment = i * config.num_topics;
+        apps[i].num_assignments = config.num_topics;
+        // Fisher-Yates with the raw generator, std::shuffle is not the same on every standard library
+        for (uint32_t j = config.num_topics - 1; j > 0; j--) {
+            std::swap(order[j], order[rnd_gen() % (j + 1)]);
+        }
+        std::memcpy(assignments + apps[i].first_assignment, order.data(), order.size() * sizeof(uint32_t));
+    }
+    // the header is written last, a child that maps a plan that is not complete fails on the magic
+    std::memcpy(ptr, &header, sizeof(header));
+    munmap(ptr, header.size);
+    return 0;
+}
+
+/**
+ * read only view of the plan in a child process
+ */
+class TestPlan {
+public:
+    TestPlan() = default;
+    ~TestPlan() {
+        if (ptr_ != nullptr) {
+            munmap(const_cast<uint8_t*>(ptr_), size_);
+        }
+    }
+    TestPlan(const TestPlan&) = delete;
+    TestPlan& operator=(const TestPlan&) = delete;
+
+    auto open(const std::string &shm_name) -> int {
+        int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+        if (-1 == fd) {
+            spdlog::error("Failed to open {} test plan, {}", shm_name, strerror(errno));
+            return -1;
+        }
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(test_plan_header)) {
+            spdlog::error("test plan {} is too small", shm_name);
+            close(fd);
+            return -1;
+        }
+        size_ = st.st_size;
+        auto ptr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (MAP_FAILED == ptr) {
+            spdlog::error("Failed to map {} test plan, {}", shm_name, strerror(errno));
+            return -1;
+        }
+        ptr_ = static_cast<const uint8_t*>(ptr);
+        auto h = header();
+        if (h->magic != TEST_PLAN_MAGIC || h->version != TEST_PLAN_VERSION || h->size != size_) {
+            spdlog::error("invalid test plan {}", shm_name);
+            munmap(ptr, size_);
+            ptr_ = nullptr;
+            return -1;
+        }
+        return 0;
+    }
+
+    inline auto header() const -> const test_plan_header* {
+        return reinterpret_cast<const test_plan_header*>(ptr_);
+    }
+
+    inline auto topology() const -> topology_s {
+        return {static_cast<int>(header()->pubs), static_cast<int>(header()->subs)};
+    }
+
+    inline auto locator() const -> std::string {
+        return header()->locator;
+    }
+
+    inline auto workingDir() const -> std::filesystem::path {
+        return std::filesystem::path(header()->working_dir);
+    }
+
+    auto app(const std::string &name) const -> const test_plan_app* {
+        auto apps = reinterpret_cast<const test_plan_app*>(ptr_ + header()->apps_offset);
+        for (uint32_t i = 0; i < header()->num_apps; i++) {
+            if (name == apps[i].name) {
+                return &apps[i];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * the topics of the app in the order of the plan
+     */
+    auto topics(const test_plan_app &app) const -> std::vector<const test_plan_topic*> {
+        auto topics = reinterpret_cast<const test_plan_topic*>(ptr_ + header()->topics_offset);
+        auto assignments = reinterpret_cast<const uint32_t*>(ptr_ + header()->assignments_offset);
+        std::vector<const test_plan_topic*> res {};
+        res.reserve(app.num_assignments);
+        for (uint32_t i = 0; i < app.num_assignments; i++) {
+            res.push_back(&topics[assignments[app.first_assignment + i]]);
+        }
+        return res;
+    }
+
+    /**
+     * the index of the topic in the plan, from its ids (see createTestPlan)
+     */
+    static inline auto topicIndex(uint32_t entity_id, uint32_t resource_id) -> uint32_t {
+        return ((entity_id - 1) << 12) | ((resource_id >> 3) - 1);
+    }
+
+    static auto buildUri(const test_plan_topic &topic) -> uprotocol::v1::UUri {
+        auto u_authority = uprotocol::uri::BuildUAuthority().build();
+        auto u_entity = uprotocol::uri::BuildUEntity().setId(topic.entity_id).setMajorVersion(1).build();
+        auto u_resource = uprotocol::uri::BuildUResource().setID(topic.resource_id).build();
+        return uprotocol::uri::BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
+    }
+
+private:
+    const uint8_t *ptr_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_TEST_PLAN_H
@@ -62,6 +62,8 @@
 #include <up-cpp/uri/serializer/LongUriSerializer.h>
 #include <up-cpp/uri/serializer/MicroUriSerializer.h>
 
+#include "Locator.h"
+
 
 
 #define likely(x) __builtin_expect(!!(x), 1)
@@ -101,6 +103,53 @@ auto static inline createServerPortlist(int num_of_process = MAX_PROCESS) -> std
     return conf_map;
 }
 
+/**
+ * number of publishers and subscribers of a run, written as "PxS"
+ * 1xN is fan-out, Nx1 is fan-in and NxM is a mesh, every publisher connects to every subscriber
+ */
+struct topology_s {
+    int pubs;
+    int subs;
+};
+
+static inline auto parseTopology(const std::string &str) -> std::optional<topology_s> {
+    auto pos = str.find('x');
+    if (pos == std::string::npos) {
+        return std::nullopt;
+    }
+    char *endptr;
+    topology_s topology {};
+    topology.pubs = std::strtol(str.substr(0, pos).c_str(), &endptr, 10);
+    topology.subs = std::strtol(str.substr(pos + 1).c_str(), &endptr, 10);
+    if (topology.pubs < 1 || topology.subs < 1) {
+        return std::nullopt;
+    }
+    return topology;
+}
+
+static inline auto topologyToString(const topology_s &topology) -> std::string {
+    return std::to_string(topology.pubs) + "x" + std::to_string(topology.subs);
+}
+
+/**
+ * app0 .. app(pubs - 1) are the publishers and app(pubs) .. app(pubs + subs - 1) the subscribers
+ * every app gets the endpoint of its index in the locator scheme (see Locator.h)
+ */
+auto static inline createServerPortlist(const topology_s &topology, const std::string &scheme = LOCATOR_SCHEMES[0]) -> std::unordered_map<std::string, std::pair<std::string, std::string>> {
+    std::unordered_map<std::string, std::pair<std::string, std::string>> conf_map;
+    std::string key_base = "app";
+    
+    for (auto i = 0; i < topology.pubs + topology.subs; i++) {
+        std::string app_type = (i < topology.pubs) ? PUB : SUB;
+        std::string key = key_base + std::to_string(i);
+        auto endpoint = createLocator(scheme, i);
+        auto value = std::make_pair(app_type, endpoint.has_value() ? toEndpointList(endpoint.value()) : "");
+        conf_map[key] = value;
+    }
+    
+    return conf_map;
+}
+
 auto static inline getAllTypeKeys(std::unordered_map<std::string, std::pair<std::string, std::string>> conf_map, std::string filter) -> std::string {
     std::stringstream s;
     s <<  "[";
@@ -210,12 +259,17 @@ static inline auto convertHexStringToUint8Vec(const std::string &str) -> std::ve
     return res;
 }
 
+/**
+ * create size unique URIs, the micro uri has 16 bit for the entity and resource ids
+ * so every entity gets 4096 resources
+ */
 auto static inline createVectorofUUri(size_t size) -> std::vector<uprotocol::v1::UUri> {
     std::vector<uprotocol::v1::UUri> uri_vec {};
-    for (size_t i = 1; i <= size; i++) {
+    uri_vec.reserve(size);
+    for (size_t i = 0; i < size; i++) {
         auto u_authority = uprotocol::uri::BuildUAuthority().build();
-        auto u_entity = uprotocol::uri::BuildUEntity().setId(i).setMajorVersion(1).build();
-        auto u_resource = uprotocol::uri::BuildUResource().setID((i + 1) << 3).build();
+        auto u_entity = uprotocol::uri::BuildUEntity().setId((i >> 12) + 1).setMajorVersion(1).build();
+        auto u_resource = uprotocol::uri::BuildUResource().setID(((i & 0xfff) + 1) << 3).build();
         auto u_uri = uprotocol::uri::BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
         uri_vec.push_back(u_uri);
     }   
@@ -403,6 +457,10 @@ static inline auto getSkew(std::vector<T>& vec, double mean) -> std::optional<do
     if (!median.has_value()) {
         return std::nullopt;
     }
+    if (std.value() == 0) {
+        // constant samples, no skew instead of 0 / 0
+        return 0.0;
+    }
     
     return (3 * ( mean - median.value())) / std.value();   
 }
@@ -413,8 +471,12 @@ static inline auto getKurtosis(std::vector<T>& vec, double mean, double std) ->
     if (size < 3) {
         return std::nullopt;
     }
+    if (std == 0) {
+        // constant samples, reported as a normal tail instead of NaN
+        return 0.0;
+    }
     
-    return (1 / size) * std::accumulate(vec.begin(), vec.end(), 0.0, [=](double acc, const auto & e){
+    return (1.0 / size) * std::accumulate(vec.begin(), vec.end(), 0.0, [=](double acc, const auto & e){
         return acc + std::pow(((e - mean) / std), 4);
     }) - 3;
 }
@@ -537,6 +599,25 @@ auto generateRandomString(size_t size) -> std::string {
     return rnd_str;
 }
 
+/**
+ * resident set size of this process in bytes
+ * @return -1 if /proc/self/statm can't be read
+ */
+static auto inline getResidentMemory() -> long {
+    long size = 0;
+    long resident = 0;
+    auto fp = fopen("/proc/self/statm", "r");
+    if (fp == nullptr) {
+        return -1;
+    }
+    if (fscanf(fp, "%ld %ld", &size, &resident) != 2) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
 /**
  * get number of threads
  * we subtruct 1 
@@ -0,0 +1,256 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_WINDOW_H
+#define UP_ZENOH_EXAMPLE_CPP_WINDOW_H
+
+#include "utils.h"
+#include "filesys.h"
+
+constexpr uint32_t WINDOW_US = 100000;
+constexpr double WARMUP_FACTOR = 1.5; // a window is steady when its p50 is below 1.5 x the steady p50
+constexpr size_t WARMUP_STABLE_WINDOWS = 3;
+const std::string WINDOW_PREFIX = "win-";
+const std::string WARMUP_PREFIX = "warmup-";
+
+struct window_stat {
+    double start; // CLOCK_MONOTONIC, the same clock in all the processes of a run
+    size_t count;
+    double p50;
+    double p99;
+    double max;
+    bool warmup;
+};
+
+/**
+ * index of the first window of the steady state, the windows before it are marked as warm-up
+ * the steady p50 is the median p50 of the second half of the run, the warm-up ends at the first
+ * WARMUP_STABLE_WINDOWS windows in a row that are all close to it
+ */
+static inline auto detectWarmup(std::vector<window_stat> &windows) -> size_t {
+    if (windows.size() < 2 * WARMUP_STABLE_WINDOWS) {
+        return 0;
+    }
+    std::vector<double> late {};
+    for (auto i = windows.size() / 2; i < windows.size(); i++) {
+        if (windows[i].count > 0) {
+            late.push_back(windows[i].p50);
+        }
+    }
+    auto steady = getMedian(late);
+    if (!steady.has_value()) {
+        return 0;
+    }
+    size_t first = 0;
+    size_t stable = 0;
+    for (size_t i = 0; i < windows.size(); i++) {
+        if (windows[i].count > 0 && windows[i].p50 <= WARMUP_FACTOR * steady.value()) {
+            if (stable == 0) {
+                first = i;
+            }
+            if (++stable == WARMUP_STABLE_WINDOWS) {
+                break;
+            }
+        } else {
+            stable = 0;
+        }
+    }
+    if (stable < WARMUP_STABLE_WINDOWS) {
+        return 0;
+    }
+    for (size_t i = 0; i < first; i++) {
+        windows[i].warmup = true;
+    }
+    return first;
+}
+
+/**
+ * the samples of one process with the time they were taken, cut into fixed windows at the end of the run
+ */
+class WindowSeries {
+public:
+    explicit WindowSeries(double window) : window_(window > 0 ? window : WINDOW_US * 1.0e-6) {}
+
+    inline auto add(const struct timespec &tm, double value) -> void {
+        samples_.emplace_back((double)tm.tv_sec + (double)tm.tv_nsec * 1.0e-9, value);
+    }
+
+    inline auto reserve(size_t size) -> void {
+        samples_.reserve(size);
+    }
+
+    /**
+     * build the windows and split the samples in warm-up and steady state
+     */
+    auto finish() -> void {
+        windows_.clear();
+        steady_.clear();
+        warmup_.clear();
+        if (samples_.empty()) {
+            return;
+        }
+        std::sort(samples_.begin(), samples_.end());
+        auto origin = samples_.front().first;
+        std::vector<double> values {};
+        size_t begin = 0;
+        auto windowOf = [&](size_t i) {
+            return static_cast<size_t>((samples_[i].first - origin) / window_);
+        };
+        while (begin < samples_.size()) {
+            auto index = windowOf(begin);
+            // empty windows are kept, a stall with no samples at all is a window with count 0
+            while (windows_.size() < index) {
+                windows_.push_back({origin + windows_.size() * window_, 0, 0, 0, 0, false});
+            }
+            values.clear();
+            auto end = begin;
+            while (end < samples_.size() && windowOf(end) == index) {
+                values.push_back(samples_[end].second);
+                end++;
+            }
+            std::sort(values.begin(), values.end());
+            window_stat stat {};
+            stat.start = origin + index * window_;
+            stat.count = values.size();
+            stat.p50 = getPercentileFromSortedVec(values, 50).value();
+            stat.p99 = getPercentileFromSortedVec(values, 99).value();
+            stat.max = values.back();
+            windows_.push_back(stat);
+            begin = end;
+        }
+        auto first = detectWarmup(windows_);
+        warmup_end_ = first < windows_.size() ? windows_[first].start : origin;
+        for (auto const &e : samples_) {
+            (e.first < warmup_end_ ? warmup_ : steady_).push_back(e.second);
+        }
+    }
+
+    inline auto windows() -> std::vector<window_stat>& {
+        return windows_;
+    }
+
+    inline auto steady() -> std::vector<double>& {
+        return steady_;
+    }
+
+    inline auto warmup() -> std::vector<double>& {
+        return warmup_;
+    }
+
+    inline auto warmupSeconds() const -> double {
+        return samples_.empty() ? 0.0 : warmup_end_ - samples_.front().first;
+    }
+
+private:
+    double window_;
+    double warmup_end_ = 0;
+    std::vector<std::pair<double, double>> samples_ {};
+    std::vector<window_stat> windows_ {};
+    std::vector<double> steady_ {};
+    std::vector<double> warmup_ {};
+};
+
+static inline auto writeWindows(const std::filesystem::path &file_name, const std::vector<window_stat> &windows) -> int {
+    std::stringstream s;
+    s << "start,count,p50,p99,max,warmup\n" << std::fixed << std::setprecision(9);
+    for (auto const &w : windows) {
+        s << w.start << "," << w.count << "," << w.p50 << "," << w.p99 << "," << w.max << "," << (w.warmup ? 1 : 0) << "\n";
+    }
+    return writeFileAtomic(file_name, s.str());
+}
+
+static inline auto readWindows(const std::filesystem::path &file_name) -> std::vector<window_stat> {
+    std::vector<window_stat> windows {};
+    std::ifstream input_file(file_name);
+    std::string line {};
+    std::getline(input_file, line); // header
+    while (std::getline(input_file, line)) {
+        window_stat w {};
+        int warmup = 0;
+        if (std::sscanf(line.c_str(), "%lf,%zu,%lf,%lf,%lf,%d", &w.start, &w.count, &w.p50, &w.p99, &w.max, &warmup) == 6) {
+            w.warmup = warmup != 0;
+            windows.push_back(w);
+        }
+    }
+    return windows;
+}
+
+struct window_summary {
+    size_t windows;
+    size_t empty;
+    double warmup; // seconds from the first window
+    double worst_p99;
+    double worst_p99_at; // seconds from origin
+    double worst_max;
+    double worst_max_at;
+};
+
+/**
+ * the stalls of a series, origin is the start of the run so the series of all the processes line up
+ */
+static inline auto summarizeWindows(const std::vector<window_stat> &windows, double origin) -> window_summary {
+    window_summary res {};
+    res.windows = windows.size();
+    for (auto const &w : windows) {
+        if (!w.warmup) {
+            res.warmup = w.start - windows.front().start;
+            break;
+        }
+    }
+    for (auto const &w : windows) {
+        if (w.count == 0) {
+            res.empty++;
+            continue;
+        }
+        if (w.warmup) {
+            continue;
+        }
+        if (w.p99 > res.worst_p99) {
+            res.worst_p99 = w.p99;
+            res.worst_p99_at = w.start - origin;
+        }
+        if (w.max > res.worst_max) {
+            res.worst_max = w.max;
+            res.worst_max_at = w.start - origin;
+        }
+    }
+    return res;
+}
+
+/**
+ * write the windows, the steady state samples (file_name) and the warm-up samples of a process
+ */
+static inline auto writeSeries(const std::filesystem::path &dir, const std::string &file_name, WindowSeries &series) -> void {
+    series.finish();
+    writeWindows(dir / (WINDOW_PREFIX + file_name + ".csv"), series.windows());
+    if (!series.steady().empty()) {
+        writeVecToFile(dir / file_name, series.steady());
+    }
+    if (!series.warmup().empty()) {
+        writeVecToFile(dir / (WARMUP_PREFIX + file_name), series.warmup());
+    }
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_WINDOW_H
@@ -0,0 +1,372 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_ASYNCPUBLISHER_H
+#define UP_ZENOH_EXAMPLE_CPP_ASYNCPUBLISHER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <up-cpp/transport/UTransport.h>
+#include <up-cpp/transport/datamodel/UMessage.h>
+
+#include "MessageBuilder.h"
+
+constexpr size_t ASYNC_QUEUE_SIZE = 1024; // rounded up to a power of 2
+constexpr int ASYNC_IDLE_SPINS = 1000; // polls of the I/O thread before it sleeps
+
+/**
+ * what enqueue does with a message of the topic when the queue is full
+ */
+enum class overflow_policy {
+    KEEP_LATEST,  // the message replaces the last overflowed one of the topic, the I/O thread sends it next and drops
+                  // the older messages of the topic still in the queue, so the last value sent is the newest
+    DROP_NEWEST,  // the message is dropped
+    BLOCK         // wait for a free slot up to the timeout of the topic, then drop
+};
+
+struct async_topic_metrics {
+    std::string name;
+    uint64_t enqueued;
+    uint64_t sent;
+    uint64_t dropped;
+    uint64_t send_errors;
+    double latency_mean; // enqueue to send, in seconds
+    double latency_max;
+};
+
+struct async_metrics {
+    size_t depth;
+    size_t max_depth;
+    std::vector<async_topic_metrics> topics;
+};
+
+/**
+ * publish front-end, the producers copy the message into a bounded lock free ring
+ * (multi producer, single consumer, one sequence number per cell) and a dedicated I/O thread
+ * builds the UMessage and calls send(), a failed send is counted and the next message is sent
+ */
+class AsyncPublisher {
+public:
+    explicit AsyncPublisher(uprotocol::utransport::UTransport &transport, size_t size = ASYNC_QUEUE_SIZE)
+        : transport_(transport), cells_(roundUpPow2(size)), mask_(cells_.size() - 1) {
+        for (size_t i = 0; i < cells_.size(); i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~AsyncPublisher() {
+        stop();
+    }
+
+    AsyncPublisher(const AsyncPublisher&) = delete;
+    AsyncPublisher& operator=(const AsyncPublisher&) = delete;
+
+    /**
+     * topics are added before start()
+     * @return the topic id for enqueue()
+     */
+    auto addTopic(const std::string &name,
+                  const uprotocol::v1::UUri &uri,
+                  overflow_policy policy,
+                  std::chrono::microseconds timeout = std::chrono::microseconds(0)) -> size_t {
+        topics_.push_back(std::make_unique<topic_s>());
+        auto &topic = *topics_.back();
+        topic.name = name;
+        topic.uri = uri;
+        topic.attributes.emplace(uri);
+        topic.policy = policy;
+        topic.timeout = timeout;
+        return topics_.size() - 1;
+    }
+
+    auto start() -> void {
+        running_.store(true);
+        io_thread_ = std::thread([this]() { run(); });
+    }
+
+    /**
+     * send what is left in the queue and stop the I/O thread
+     */
+    auto stop() -> void {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        wake();
+        io_thread_.join();
+    }
+
+    /**
+     * copy the message to the queue, safe from any thread
+     * @return OK, or RESOURCE_EXHAUSTED when the message was dropped
+     */
+    auto enqueue(size_t topic_id, const uint8_t *data, size_t size) -> uprotocol::v1::UCode {
+        auto &topic = *topics_[topic_id];
+        topic.enqueued.fetch_add(1, std::memory_order_relaxed);
+        if (tryPush(topic_id, data, size)) {
+            return uprotocol::v1::UCode::OK;
+        }
+        switch (topic.policy) {
+            case overflow_policy::KEEP_LATEST: {
+                std::lock_guard<std::mutex> lock(topic.latest_mutex);
+                if (topic.latest_pending) {
+                    topic.dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                topic.latest.assign(data, data + size);
+                // the messages of the topic queued before this position are older than the latest
+                topic.latest_position = head_.load(std::memory_order_relaxed);
+                topic.latest_time = std::chrono::steady_clock::now();
+                topic.latest_pending = true;
+                latest_pending_.store(true, std::memory_order_release);
+                wake();
+                return uprotocol::v1::UCode::OK;
+            }
+            case overflow_policy::BLOCK: {
+                auto deadline = std::chrono::steady_clock::now() + topic.timeout;
+                while (std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::yield();
+                    if (tryPush(topic_id, data, size)) {
+                        return uprotocol::v1::UCode::OK;
+                    }
+                }
+                break;
+            }
+            case overflow_policy::DROP_NEWEST:
+                break;
+        }
+        topic.dropped.fetch_add(1, std::memory_order_relaxed);
+        return uprotocol::v1::UCode::RESOURCE_EXHAUSTED;
+    }
+
+    auto metrics() -> async_metrics {
+        async_metrics res {};
+        auto tail = tail_.load(std::memory_order_relaxed);
+        auto head = head_.load(std::memory_order_relaxed);
+        res.depth = head > tail ? head - tail : 0;
+        res.max_depth = max_depth_.load(std::memory_order_relaxed);
+        for (auto const &topic : topics_) {
+            async_topic_metrics m {};
+            m.name = topic->name;
+            m.enqueued = topic->enqueued.load(std::memory_order_relaxed);
+            m.dropped = topic->dropped.load(std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(topic->stats_mutex);
+            m.sent = topic->sent;
+            m.send_errors = topic->send_errors;
+            m.latency_mean = topic->sent > 0 ? topic->latency_sum / topic->sent : 0.0;
+            m.latency_max = topic->latency_max;
+            res.topics.push_back(m);
+        }
+        return res;
+    }
+
+private:
+    struct cell_s {
+        std::atomic<size_t> sequence {0};
+        size_t topic_id = 0;
+        std::vector<uint8_t> data {}; // keeps its capacity, the cell is reused every size messages
+        std::chrono::steady_clock::time_point time {};
+    };
+
+    struct topic_s {
+        std::string name;
+        uprotocol::v1::UUri uri;
+        std::optional<ReusableAttributes> attributes; // used by the I/O thread only
+        overflow_policy policy;
+        std::chrono::microseconds timeout;
+        std::atomic<uint64_t> enqueued {0};
+        std::atomic<uint64_t> dropped {0};
+        std::mutex latest_mutex {};
+        std::vector<uint8_t> latest {};
+        std::chrono::steady_clock::time_point latest_time {};
+        bool latest_pending = false;
+        size_t latest_position = 0;
+        size_t superseded_before = 0; // queue position, used by the I/O thread only
+        std::mutex stats_mutex {}; // written by the I/O thread only, read by metrics()
+        uint64_t sent = 0;
+        uint64_t send_errors = 0;
+        double latency_sum = 0;
+        double latency_max = 0;
+    };
+
+    static auto roundUpPow2(size_t size) -> size_t {
+        size_t res = 2;
+        while (res < size) {
+            res <<= 1;
+        }
+        return res;
+    }
+
+    auto tryPush(size_t topic_id, const uint8_t *data, size_t size) -> bool {
+        auto pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            auto &cell = cells_[pos & mask_];
+            auto sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.topic_id = topic_id;
+                    cell.data.assign(data, data + size);
+                    cell.time = std::chrono::steady_clock::now();
+                    // the depth is taken before the cell is published, the I/O thread can't pop past pos until then
+                    auto depth = pos + 1 - std::min(tail_.load(std::memory_order_relaxed), pos);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    auto max_depth = max_depth_.load(std::memory_order_relaxed);
+                    while (depth > max_depth && !max_depth_.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed)) {
+                    }
+                    // pairs with the store of sleeping_ in run(), one of the two sees the other
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (sleeping_.load(std::memory_order_relaxed)) {
+                        wake();
+                    }
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    auto wake() -> void {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.notify_one();
+    }
+
+    auto send(topic_s &topic, const std::vector<uint8_t> &data, std::chrono::steady_clock::time_point time) -> void {
+        uprotocol::utransport::UPayload payload(data.data(), data.size(), uprotocol::utransport::UPayloadType::VALUE);
+        uprotocol::utransport::UMessage umsg(payload, topic.attributes->next());
+        auto status = transport_.send(umsg);
+        auto latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - time).count();
+        std::lock_guard<std::mutex> lock(topic.stats_mutex);
+        if (uprotocol::v1::UCode::OK != status.code()) {
+            topic.send_errors++;
+            return;
+        }
+        topic.sent++;
+        topic.latency_sum += latency;
+        topic.latency_max = std::max(topic.latency_max, latency);
+    }
+
+    auto sendLatest() -> void {
+        latest_pending_.store(false, std::memory_order_relaxed);
+        std::vector<uint8_t> data {};
+        for (auto &topic : topics_) {
+            std::chrono::steady_clock::time_point time {};
+            {
+                std::lock_guard<std::mutex> lock(topic->latest_mutex);
+                if (!topic->latest_pending) {
+                    continue;
+                }
+                data.swap(topic->latest);
+                time = topic->latest_time;
+                topic->latest_pending = false;
+                topic->superseded_before = std::max(topic->superseded_before, topic->latest_position);
+            }
+            send(*topic, data, time);
+        }
+    }
+
+    /**
+     * the only consumer, pops in order and sleeps after ASYNC_IDLE_SPINS empty polls
+     */
+    auto tryPop() -> bool {
+        auto pos = tail_.load(std::memory_order_relaxed);
+        auto &cell = cells_[pos & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        auto &topic = *topics_[cell.topic_id];
+        // a newer value of the topic was already sent from the overflow, this one is dropped
+        if (pos < topic.superseded_before) {
+            topic.dropped.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            send(topic, cell.data, cell.time);
+        }
+        tail_.store(pos + 1, std::memory_order_relaxed);
+        cell.sequence.store(pos + cells_.size(), std::memory_order_release);
+        return true;
+    }
+
+    auto run() -> void {
+        int idle = 0;
+        while (true) {
+            auto popped = tryPop();
+            // the overflowed latest values go out between the queued messages so a full queue can't starve them,
+            // the older messages of their topic still in the queue are dropped when they are popped
+            if (latest_pending_.load(std::memory_order_acquire)) {
+                sendLatest();
+                continue;
+            }
+            if (popped) {
+                idle = 0;
+                continue;
+            }
+            if (!running_.load()) {
+                break;
+            }
+            if (++idle < ASYNC_IDLE_SPINS) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // a producer that pushed before it saw sleeping_ is caught by the check under the lock
+            auto &cell = cells_[tail_.load(std::memory_order_relaxed) & mask_];
+            if (cell.sequence.load(std::memory_order_acquire) != tail_.load(std::memory_order_relaxed) + 1 &&
+                !latest_pending_.load(std::memory_order_acquire) && running_.load()) {
+                sleep_cv_.wait_for(lock, std::chrono::milliseconds(10));
+            }
+            sleeping_.store(false, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+
+    uprotocol::utransport::UTransport &transport_;
+    std::vector<cell_s> cells_;
+    size_t mask_;
+    std::vector<std::unique_ptr<topic_s>> topics_ {};
+    alignas(64) std::atomic<size_t> head_ {0};
+    alignas(64) std::atomic<size_t> tail_ {0};
+    std::atomic<size_t> max_depth_ {0};
+    std::atomic<bool> latest_pending_ {false};
+    std::atomic<bool> running_ {false};
+    std::atomic<bool> sleeping_ {false};
+    std::mutex sleep_mutex_ {};
+    std::condition_variable sleep_cv_ {};
+    std::thread io_thread_ {};
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_ASYNCPUBLISHER_H
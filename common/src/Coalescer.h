@@ -0,0 +1,245 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_COALESCER_H
+#define UP_ZENOH_EXAMPLE_CPP_COALESCER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <up-cpp/transport/UListener.h>
+#include <up-cpp/transport/datamodel/UMessage.h>
+
+#include "SessionPool.h"
+#include "MessageBuilder.h"
+
+/**
+ * the payload of a container message, host byte order like the payloads of the examples
+ * | version (1) | reserved (1) | count (2) | count x record |
+ * record : | entity id (2) | resource id (2) | size (2) | size bytes |
+ */
+constexpr uint8_t COALESCE_VERSION = 1;
+constexpr size_t COALESCE_HEADER_SIZE = 4;
+constexpr size_t COALESCE_RECORD_HEADER_SIZE = 6;
+constexpr size_t COALESCE_MAX_PAYLOAD = 1024;
+
+static inline auto getCoalesceKey(const uprotocol::v1::UUri &uri) -> uint32_t {
+    return (uri.entity().id() << 16) | (uri.resource().id() & 0xffff);
+}
+
+/**
+ * packs the updates of small topics into one message on a container topic,
+ * the frame is sent when the oldest update in it is budget old, when the next update
+ * doesn't fit in max_payload or on flush()
+ */
+class CoalescingPublisher {
+public:
+    CoalescingPublisher(std::shared_ptr<PooledSession> session,
+                        const uprotocol::v1::UUri &container,
+                        std::chrono::microseconds budget,
+                        size_t max_payload = COALESCE_MAX_PAYLOAD)
+        : session_(std::move(session)), attributes_(container), budget_(budget), max_payload_(max_payload) {
+        frame_.reserve(max_payload_);
+        resetFrame();
+        flusher_ = std::thread([this]() { run(); });
+    }
+
+    ~CoalescingPublisher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        flusher_.join();
+        flush();
+    }
+
+    CoalescingPublisher(const CoalescingPublisher&) = delete;
+    CoalescingPublisher& operator=(const CoalescingPublisher&) = delete;
+
+    /**
+     * add the update of topic to the frame, the data is copied
+     */
+    auto update(const uprotocol::v1::UUri &topic, const uint8_t *data, size_t size) -> uprotocol::v1::UCode {
+        if (size > 0xffff || COALESCE_HEADER_SIZE + COALESCE_RECORD_HEADER_SIZE + size > max_payload_) {
+            return uprotocol::v1::UCode::INVALID_ARGUMENT;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (frame_.size() + COALESCE_RECORD_HEADER_SIZE + size > max_payload_) {
+            auto code = sendLocked();
+            if (uprotocol::v1::UCode::OK != code) {
+                return code;
+            }
+        }
+        auto key = getCoalesceKey(topic);
+        uint16_t entity_id = key >> 16;
+        uint16_t resource_id = key & 0xffff;
+        uint16_t record_size = static_cast<uint16_t>(size);
+        auto offset = frame_.size();
+        frame_.resize(offset + COALESCE_RECORD_HEADER_SIZE + size);
+        std::memcpy(&frame_[offset], &entity_id, sizeof(entity_id));
+        std::memcpy(&frame_[offset + 2], &resource_id, sizeof(resource_id));
+        std::memcpy(&frame_[offset + 4], &record_size, sizeof(record_size));
+        std::memcpy(&frame_[offset + COALESCE_RECORD_HEADER_SIZE], data, size);
+        if (count_++ == 0) {
+            deadline_ = std::chrono::steady_clock::now() + budget_;
+            lock.unlock();
+            cv_.notify_one();
+        }
+        return uprotocol::v1::UCode::OK;
+    }
+
+    /**
+     * send the frame now
+     */
+    auto flush() -> uprotocol::v1::UCode {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sendLocked();
+    }
+
+    inline auto messagesSent() -> size_t {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sent_;
+    }
+
+    inline auto updatesSent() -> size_t {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return updates_;
+    }
+
+private:
+    auto resetFrame() -> void {
+        frame_.assign(COALESCE_HEADER_SIZE, 0);
+        frame_[0] = COALESCE_VERSION;
+        count_ = 0;
+    }
+
+    auto sendLocked() -> uprotocol::v1::UCode {
+        if (count_ == 0) {
+            return uprotocol::v1::UCode::OK;
+        }
+        std::memcpy(&frame_[2], &count_, sizeof(count_));
+        uprotocol::utransport::UPayload payload(frame_.data(), frame_.size(), uprotocol::utransport::UPayloadType::VALUE);
+        uprotocol::utransport::UMessage umsg(payload, attributes_.next());
+        auto status = session_->send(umsg);
+        updates_ += count_;
+        sent_++;
+        resetFrame();
+        return status.code();
+    }
+
+    auto run() -> void {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            if (count_ == 0) {
+                cv_.wait(lock, [this]() { return stop_ || count_ > 0; });
+                continue;
+            }
+            if (cv_.wait_until(lock, deadline_, [this]() { return stop_ || count_ == 0; })) {
+                continue;
+            }
+            sendLocked();
+        }
+    }
+
+    std::shared_ptr<PooledSession> session_;
+    ReusableAttributes attributes_; // of the container topic
+    std::chrono::microseconds budget_;
+    size_t max_payload_;
+    std::vector<uint8_t> frame_ {};
+    uint16_t count_ = 0;
+    std::chrono::steady_clock::time_point deadline_ {};
+    size_t sent_ = 0;
+    size_t updates_ = 0;
+    bool stop_ = false;
+    std::mutex mutex_ {};
+    std::condition_variable cv_ {};
+    std::thread flusher_ {};
+};
+
+/**
+ * the listener of the container topic, every record is handed to the listener of its topic
+ * as a message with the topic as source, so the listeners don't know the updates were coalesced
+ */
+class DemuxListener : public uprotocol::utransport::UListener {
+public:
+    auto add(const uprotocol::v1::UUri &topic, uprotocol::utransport::UListener &listener) -> void {
+        topics_[getCoalesceKey(topic)] = {topic, &listener};
+    }
+
+    uprotocol::v1::UStatus onReceive(uprotocol::utransport::UMessage &umsg) override {
+        uprotocol::v1::UStatus status;
+        auto payload = umsg.payload();
+        auto data = payload.data();
+        auto size = payload.size();
+        uint16_t count = 0;
+        if (size < COALESCE_HEADER_SIZE || data[0] != COALESCE_VERSION) {
+            status.set_code(uprotocol::v1::UCode::INVALID_ARGUMENT);
+            return status;
+        }
+        std::memcpy(&count, data + 2, sizeof(count));
+        size_t offset = COALESCE_HEADER_SIZE;
+        auto attributes = umsg.attributes();
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t entity_id = 0;
+            uint16_t resource_id = 0;
+            uint16_t record_size = 0;
+            if (offset + COALESCE_RECORD_HEADER_SIZE > size) {
+                status.set_code(uprotocol::v1::UCode::DATA_LOSS);
+                return status;
+            }
+            std::memcpy(&entity_id, data + offset, sizeof(entity_id));
+            std::memcpy(&resource_id, data + offset + 2, sizeof(resource_id));
+            std::memcpy(&record_size, data + offset + 4, sizeof(record_size));
+            offset += COALESCE_RECORD_HEADER_SIZE;
+            if (offset + record_size > size) {
+                status.set_code(uprotocol::v1::UCode::DATA_LOSS);
+                return status;
+            }
+            auto it = topics_.find((static_cast<uint32_t>(entity_id) << 16) | resource_id);
+            if (it != topics_.end()) {
+                *attributes.mutable_source() = it->second.first;
+                uprotocol::utransport::UPayload record(data + offset, record_size, uprotocol::utransport::UPayloadType::VALUE);
+                uprotocol::utransport::UMessage record_msg(record, attributes);
+                it->second.second->onReceive(record_msg);
+            }
+            offset += record_size;
+        }
+        status.set_code(uprotocol::v1::UCode::OK);
+        return status;
+    }
+
+private:
+    std::unordered_map<uint32_t, std::pair<uprotocol::v1::UUri, uprotocol::utransport::UListener*>> topics_ {};
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_COALESCER_H
@@ -0,0 +1,210 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_LATESTVALUECACHE_H
+#define UP_ZENOH_EXAMPLE_CPP_LATESTVALUECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <time.h>
+
+#include <up-cpp/transport/UListener.h>
+#include <up-cpp/transport/datamodel/UMessage.h>
+
+constexpr size_t LATEST_VALUE_WORDS = 6;
+constexpr size_t LATEST_VALUE_SIZE = LATEST_VALUE_WORDS * sizeof(uint64_t); // the slot is one cache line
+
+/**
+ * the current value of a topic, version is the number of writes (0 never written) so a poller can tell a new value
+ */
+struct latest_value {
+    uint64_t version;
+    int64_t received; // CLOCK_MONOTONIC of the write, in ns
+    size_t size;
+    uint8_t data[LATEST_VALUE_SIZE];
+};
+
+/**
+ * the latest value of every topic in a seqlock, one cache line per topic so topics don't share lines.
+ * a writer takes the slot by moving the sequence from even to odd with a compare and swap, so a topic can be
+ * written from several threads (a topic and its container on two subscriptions). any number of threads read without
+ * locks: the reader copies the slot and retries when the sequence was odd or changed during the copy. the words are relaxed atomics so the copy
+ * that races with a write is not undefined behaviour, the fences order them against the sequence
+ * values bigger than LATEST_VALUE_SIZE are not cached
+ */
+class LatestValueCache {
+public:
+    explicit LatestValueCache(size_t capacity) : slots_(new slot_s[capacity]), capacity_(capacity) {}
+
+    LatestValueCache(const LatestValueCache&) = delete;
+    LatestValueCache& operator=(const LatestValueCache&) = delete;
+
+    /**
+     * topics are added before the listeners are registered
+     * @return the index of the topic, or nullopt when the cache is full
+     */
+    auto add(uint32_t key) -> std::optional<size_t> {
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            return it->second;
+        }
+        if (size_ == capacity_) {
+            return std::nullopt;
+        }
+        index_[key] = size_;
+        return size_++;
+    }
+
+    auto find(uint32_t key) const -> std::optional<size_t> {
+        auto it = index_.find(key);
+        return it == index_.end() ? std::nullopt : std::make_optional(it->second);
+    }
+
+    /**
+     * safe from any thread, concurrent writers of a topic wait for each other
+     * @return false when the value doesn't fit in a slot
+     */
+    auto write(size_t index, const uint8_t *data, size_t size) -> bool {
+        if (size > LATEST_VALUE_SIZE) {
+            return false;
+        }
+        struct timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t words[LATEST_VALUE_WORDS] {};
+        std::memcpy(words, data, size);
+        auto &slot = slots_[index];
+        auto sequence = slot.sequence.load(std::memory_order_relaxed);
+        while ((sequence & 1) || !slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire,
+                                                                        std::memory_order_relaxed)) {
+            if (sequence & 1) {
+                pause();
+                sequence = slot.sequence.load(std::memory_order_relaxed);
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.received.store(static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec, std::memory_order_relaxed);
+        slot.size.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+        for (size_t i = 0; i < LATEST_VALUE_WORDS; i++) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * a consistent copy of the slot from any thread
+     */
+    auto read(size_t index, latest_value &value) const -> uint64_t {
+        auto &slot = slots_[index];
+        uint64_t words[LATEST_VALUE_WORDS];
+        while (true) {
+            auto begin = slot.sequence.load(std::memory_order_acquire);
+            if (begin & 1) {
+                pause();
+                continue;
+            }
+            value.received = slot.received.load(std::memory_order_relaxed);
+            value.size = slot.size.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < LATEST_VALUE_WORDS; i++) {
+                words[i] = slot.words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == begin) {
+                std::memcpy(value.data, words, LATEST_VALUE_SIZE);
+                value.version = begin / 2;
+                return value.version;
+            }
+        }
+    }
+
+    /**
+     * the value as a T, the payload of the topic is a T (time, speed, gear...)
+     * @return the version, 0 when the topic was never written
+     */
+    template<typename T>
+    auto read(size_t index, T &value) const -> uint64_t {
+        static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= LATEST_VALUE_SIZE,
+                      "the value is copied in and out of one slot");
+        latest_value latest {};
+        auto version = read(index, latest);
+        if (version != 0) {
+            std::memcpy(&value, latest.data, sizeof(T));
+        }
+        return version;
+    }
+
+    inline auto size() const -> size_t {
+        return size_;
+    }
+
+private:
+    struct alignas(64) slot_s {
+        std::atomic<uint32_t> sequence {0};
+        std::atomic<uint32_t> size {0};
+        std::atomic<int64_t> received {0};
+        std::atomic<uint64_t> words[LATEST_VALUE_WORDS] {};
+    };
+    static_assert(sizeof(slot_s) == 64, "a slot is one cache line");
+
+    static inline auto pause() -> void {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    std::unique_ptr<slot_s[]> slots_;
+    size_t capacity_;
+    size_t size_ = 0;
+    std::unordered_map<uint32_t, size_t> index_ {};
+};
+
+/**
+ * the listener of a topic, writes every payload to the slot of the topic
+ */
+class LatestValueListener : public uprotocol::utransport::UListener {
+public:
+    LatestValueListener(LatestValueCache &cache, size_t index) : cache_(cache), index_(index) {}
+
+    uprotocol::v1::UStatus onReceive(uprotocol::utransport::UMessage &umsg) override {
+        uprotocol::v1::UStatus status;
+        auto payload = umsg.payload();
+        status.set_code(cache_.write(index_, payload.data(), payload.size()) ?
+                        uprotocol::v1::UCode::OK : uprotocol::v1::UCode::OUT_OF_RANGE);
+        return status;
+    }
+
+private:
+    LatestValueCache &cache_;
+    size_t index_;
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_LATESTVALUECACHE_H
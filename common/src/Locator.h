@@ -0,0 +1,80 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_LOCATOR_H
+#define UP_ZENOH_EXAMPLE_CPP_LOCATOR_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+const std::string DEFAULT_ENDPOINT = "unixpipe/pub.pipe";
+constexpr int LOCATOR_BASE_PORT = 7600;
+
+/**
+ * the local links the examples and the benchmarks can use
+ * shm (zenoh shared memory) needs transport/shared_memory in the zenoh config, ZenohSessionManagerConfig
+ * has no field for it so it is known but not available
+ */
+const std::vector<std::string> LOCATOR_SCHEMES = {"unixpipe", "unixsock-stream", "tcp", "udp", "shm"};
+
+static inline auto isLocatorAvailable(const std::string &scheme) -> bool {
+    return scheme == "unixpipe" || scheme == "unixsock-stream" || scheme == "tcp" || scheme == "udp";
+}
+
+/**
+ * endpoint of instance index for the scheme, tcp and udp use LOCATOR_BASE_PORT + index on the loopback
+ */
+static inline auto createLocator(const std::string &scheme, int index) -> std::optional<std::string> {
+    if (scheme == "unixpipe") {
+        return "unixpipe/app" + std::to_string(index) + ".pipe";
+    }
+    if (scheme == "unixsock-stream") {
+        return "unixsock-stream//tmp/app" + std::to_string(index) + ".sock";
+    }
+    if (scheme == "tcp" || scheme == "udp") {
+        return scheme + "/127.0.0.1:" + std::to_string(LOCATOR_BASE_PORT + index);
+    }
+    return std::nullopt;
+}
+
+/**
+ * @return the endpoint as the json list listenKey and connectKey expect
+ */
+static inline auto toEndpointList(const std::string &endpoint) -> std::string {
+    return "[\"" + endpoint + "\"]";
+}
+
+/**
+ * the examples take the endpoint as the first argument, both sides must use the same one
+ */
+static inline auto getEndpointFromArgs(int argc, char **argv) -> std::string {
+    if (argc >= 2) {
+        return toEndpointList(argv[1]);
+    }
+    return toEndpointList(DEFAULT_ENDPOINT);
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_LOCATOR_H
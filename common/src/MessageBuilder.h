@@ -0,0 +1,106 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_MESSAGEBUILDER_H
+#define UP_ZENOH_EXAMPLE_CPP_MESSAGEBUILDER_H
+
+#include <vector>
+
+#include <google/protobuf/arena.h>
+#include <up-cpp/transport/builder/UAttributesBuilder.h>
+#include <up-cpp/uuid/factory/Uuidv8Factory.h>
+
+#include "UuidPool.h"
+
+constexpr size_t MESSAGE_ARENA_BLOCK_SIZE = 4096;
+
+/**
+ * the attributes of a topic are built once, every message only gets a new id from the pool of the thread (UuidPool.h)
+ * the UUID is two integers so next() doesn't allocate, the source UUri and its strings are never copied again
+ * the attributes are valid until the next call of next()
+ */
+class ReusableAttributes {
+public:
+    ReusableAttributes(const uprotocol::v1::UUri &uri,
+                       uprotocol::v1::UMessageType type = uprotocol::v1::UMessageType::UMESSAGE_TYPE_PUBLISH,
+                       uprotocol::v1::UPriority priority = uprotocol::v1::UPriority::UPRIORITY_CS2)
+        : attributes_(uprotocol::utransport::UAttributesBuilder(uri, uprotocol::uuid::Uuidv8Factory::create(), type, priority).build()) {}
+
+    inline auto next() -> const uprotocol::v1::UAttributes& {
+        return next(UuidPool::local().next());
+    }
+
+    /**
+     * with an id that was created before, to time the creation of the id apart
+     */
+    inline auto next(const uprotocol::v1::UUID &id) -> const uprotocol::v1::UAttributes& {
+        *attributes_.mutable_id() = id;
+        return attributes_;
+    }
+
+private:
+    uprotocol::v1::UAttributes attributes_;
+};
+
+/**
+ * the attributes of every message are a new message on an arena whose first block is owned by this object,
+ * the arena is reset for every message so the block is reused and the heap is only touched when the
+ * attributes need more than MESSAGE_ARENA_BLOCK_SIZE bytes
+ * for callers that need a fresh message they can change (sink, ttl, ...) every time
+ */
+class ArenaAttributes {
+public:
+    ArenaAttributes(const uprotocol::v1::UUri &uri,
+                    uprotocol::v1::UMessageType type = uprotocol::v1::UMessageType::UMESSAGE_TYPE_PUBLISH,
+                    uprotocol::v1::UPriority priority = uprotocol::v1::UPriority::UPRIORITY_CS2)
+        : template_(uprotocol::utransport::UAttributesBuilder(uri, uprotocol::uuid::Uuidv8Factory::create(), type, priority).build()),
+          block_(MESSAGE_ARENA_BLOCK_SIZE),
+          arena_(getOptions(block_)) {}
+
+    ArenaAttributes(const ArenaAttributes&) = delete;
+    ArenaAttributes& operator=(const ArenaAttributes&) = delete;
+
+    inline auto next() -> uprotocol::v1::UAttributes& {
+        arena_.Reset();
+        auto attributes = google::protobuf::Arena::CreateMessage<uprotocol::v1::UAttributes>(&arena_);
+        attributes->CopyFrom(template_);
+        *attributes->mutable_id() = UuidPool::local().next();
+        return *attributes;
+    }
+
+private:
+    static auto getOptions(std::vector<char> &block) -> google::protobuf::ArenaOptions {
+        google::protobuf::ArenaOptions options {};
+        options.initial_block = block.data();
+        options.initial_block_size = block.size();
+        return options;
+    }
+
+    uprotocol::v1::UAttributes template_;
+    std::vector<char> block_;
+    google::protobuf::Arena arena_;
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_MESSAGEBUILDER_H
@@ -0,0 +1,163 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_PERIODICSCHEDULER_H
+#define UP_ZENOH_EXAMPLE_CPP_PERIODICSCHEDULER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <time.h>
+
+/**
+ * the start time of a task against its deadline, in ns
+ */
+struct periodic_stat {
+    std::string name;
+    int64_t period;
+    uint64_t runs;
+    uint64_t missed; // periods that were skipped because the task started after the next deadline
+    double jitter_mean;
+    double jitter_std;
+    int64_t jitter_max;
+};
+
+/**
+ * runs tasks on absolute deadlines with clock_nanosleep(TIMER_ABSTIME) on CLOCK_MONOTONIC,
+ * the next deadline is the previous one plus the period so the send time doesn't make the period drift.
+ * tasks with the same period are one group and run one after the other on the same deadline,
+ * a group that is late by more than a period skips the deadlines it missed instead of running in a burst
+ */
+class PeriodicScheduler {
+public:
+    using task_t = std::function<bool()>; // false stops the scheduler
+
+    /**
+     * @return the index of the task in stats()
+     */
+    auto add(const std::string &name, int64_t period_ns, task_t task) -> size_t {
+        auto group = std::find_if(groups_.begin(), groups_.end(), [=](const group_s &g) {
+            return g.period == period_ns;
+        });
+        if (group == groups_.end()) {
+            groups_.push_back({period_ns, {}, {}});
+            group = groups_.end() - 1;
+        }
+        group->tasks.push_back(tasks_.size());
+        tasks_.push_back({{name, period_ns, 0, 0, 0.0, 0.0, 0}, std::move(task), 0.0});
+        return tasks_.size() - 1;
+    }
+
+    /**
+     * run until a task returns false or terminate() is true, terminate is checked after every wake up
+     */
+    template<typename F>
+    auto run(F &&terminate) -> void {
+        struct timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (auto &group : groups_) {
+            group.deadline = now;
+        }
+        while (!groups_.empty() && !terminate()) {
+            auto next = std::min_element(groups_.begin(), groups_.end(), [](const group_s &lhs, const group_s &rhs) {
+                return toNs(lhs.deadline) < toNs(rhs.deadline);
+            });
+            // EINTR (a signal) goes back to the terminate check
+            if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next->deadline, nullptr) != 0) {
+                continue;
+            }
+            for (auto index : next->tasks) {
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                auto &task = tasks_[index];
+                addJitter(task, toNs(now) - toNs(next->deadline));
+                if (!task.task()) {
+                    return;
+                }
+            }
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            auto deadline = toNs(next->deadline) + next->period;
+            if (toNs(now) > deadline) {
+                auto skipped = (toNs(now) - deadline) / next->period + 1;
+                for (auto index : next->tasks) {
+                    tasks_[index].stat.missed += skipped;
+                }
+                deadline += skipped * next->period;
+            }
+            next->deadline = fromNs(deadline);
+        }
+    }
+
+    auto stats() const -> std::vector<periodic_stat> {
+        std::vector<periodic_stat> res {};
+        for (auto const &task : tasks_) {
+            auto stat = task.stat;
+            stat.jitter_std = stat.runs > 1 ? std::sqrt(task.m2 / (stat.runs - 1)) : 0.0;
+            res.push_back(stat);
+        }
+        return res;
+    }
+
+private:
+    struct task_s {
+        periodic_stat stat;
+        task_t task;
+        double m2; // Welford, sum of the squared differences from the mean
+    };
+
+    struct group_s {
+        int64_t period;
+        std::vector<size_t> tasks;
+        struct timespec deadline;
+    };
+
+    static inline auto toNs(const struct timespec &tm) -> int64_t {
+        return static_cast<int64_t>(tm.tv_sec) * 1000000000LL + tm.tv_nsec;
+    }
+
+    static inline auto fromNs(int64_t ns) -> struct timespec {
+        struct timespec tm{};
+        tm.tv_sec = ns / 1000000000LL;
+        tm.tv_nsec = ns % 1000000000LL;
+        return tm;
+    }
+
+    static inline auto addJitter(task_s &task, int64_t jitter) -> void {
+        auto &stat = task.stat;
+        stat.runs++;
+        auto delta = jitter - stat.jitter_mean;
+        stat.jitter_mean += delta / stat.runs;
+        task.m2 += delta * (jitter - stat.jitter_mean);
+        stat.jitter_max = std::max(stat.jitter_max, jitter);
+    }
+
+    std::vector<task_s> tasks_ {};
+    std::vector<group_s> groups_ {};
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_PERIODICSCHEDULER_H
@@ -0,0 +1,141 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_SESSIONPOOL_H
+#define UP_ZENOH_EXAMPLE_CPP_SESSIONPOOL_H
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <up-client-zenoh-cpp/transport/zenohUTransport.h>
+
+/**
+ * ZenohUTransport that exposes the init status, this is the session that is shared
+ * by all the components of the process
+ */
+class PooledSession : public uprotocol::utransport::ZenohUTransport {
+public:
+    PooledSession(ZenohSessionManagerConfig &config) : ZenohUTransport(config) {}
+    ~PooledSession() {}
+
+    inline auto getSuccess() -> uprotocol::v1::UStatus {
+        return uSuccess_;
+    }
+};
+
+/**
+ * Keeps one warm session per configuration for the whole process.
+ * prepare() starts opening the session on a background thread so the caller can parse
+ * the configuration and build the URIs and attributes at the same time, acquire() waits
+ * for it and returns the same session to every component that asks for the same config.
+ * The session is closed when clear() (or release()) was called and the last component dropped it.
+ */
+class SessionPool {
+public:
+    static auto instance() -> SessionPool& {
+        static SessionPool pool;
+        return pool;
+    }
+
+    /**
+     * open any transport type T (constructible from the config) on a background thread
+     * T must have getSuccess(), a transport that failed to init is returned as nullptr
+     */
+    template<typename T>
+    static auto openAsync(const ZenohSessionManagerConfig &config) -> std::future<std::shared_ptr<T>> {
+        return std::async(std::launch::async, [session_config = ZenohSessionManagerConfig(config)]() mutable {
+            auto session = std::make_shared<T>(session_config);
+            if (uprotocol::v1::UCode::OK != session->getSuccess().code()) {
+                return std::shared_ptr<T>();
+            }
+            return session;
+        });
+    }
+
+    auto prepare(const ZenohSessionManagerConfig &config) -> void {
+        std::lock_guard<std::mutex> lock(mutex_);
+        prepareLocked(getKey(config), config);
+    }
+
+    /**
+     * @return the shared session for this config, nullptr if the session init failed
+     */
+    auto acquire(const ZenohSessionManagerConfig &config) -> std::shared_ptr<PooledSession> {
+        auto key = getKey(config);
+        std::shared_future<std::shared_ptr<PooledSession>> session;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            session = prepareLocked(key, config);
+        }
+        auto res = session.get();
+        if (!res) {
+            // do not keep a failed session, the next acquire will try again
+            release(config);
+        }
+        return res;
+    }
+
+    auto release(const ZenohSessionManagerConfig &config) -> void {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_.erase(getKey(config));
+    }
+
+    auto clear() -> void {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_.clear();
+    }
+
+    auto size() -> size_t {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sessions_.size();
+    }
+
+private:
+    SessionPool() = default;
+    SessionPool(const SessionPool&) = delete;
+    SessionPool& operator=(const SessionPool&) = delete;
+
+    static auto getKey(const ZenohSessionManagerConfig &config) -> std::string {
+        return config.connectKey + "|" + config.listenKey + "|" + config.qosEnabled + "|" + config.lowLatency;
+    }
+
+    auto prepareLocked(const std::string &key, const ZenohSessionManagerConfig &config) -> std::shared_future<std::shared_ptr<PooledSession>> {
+        auto it = sessions_.find(key);
+        if (it != sessions_.end()) {
+            return it->second;
+        }
+        auto session = openAsync<PooledSession>(config).share();
+        sessions_[key] = session;
+        return session;
+    }
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<PooledSession>>> sessions_;
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_SESSIONPOOL_H
@@ -0,0 +1,311 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_SHARDEDRECEIVER_H
+#define UP_ZENOH_EXAMPLE_CPP_SHARDEDRECEIVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <up-cpp/transport/UListener.h>
+#include <up-cpp/transport/datamodel/UMessage.h>
+
+constexpr size_t SHARD_QUEUE_SIZE = 4096; // per shard, rounded up to a power of 2
+constexpr int SHARD_IDLE_SPINS = 1000; // polls of a worker before it sleeps
+
+/**
+ * a message handed to the handler on the worker of its shard, data is valid during the call only
+ */
+struct received_message {
+    uint32_t key;
+    const uint8_t *data;
+    size_t size;
+    struct timespec received; // CLOCK_MONOTONIC in the callback, the processing time minus this is the queueing delay
+};
+
+struct shard_metrics {
+    int cpu;
+    bool pinned;
+    uint64_t processed;
+    uint64_t full; // pushes that waited for a free cell
+    uint64_t dropped; // full after stop()
+    size_t max_depth;
+    double delay_mean; // callback to processing, in seconds
+    double delay_max;
+};
+
+/**
+ * moves the processing of the received messages off the transport threads.
+ * the callback copies the payload into the single producer single consumer ring of a shard and returns,
+ * the shard is a hash of the topic key so the messages of a topic stay in order, every shard has a worker
+ * pinned to a core that runs the handler.
+ * two transport threads can deliver topics of the same shard, the producer side is taken with a flag which
+ * is one uncontended exchange per message. a full ring makes the callback wait (back pressure on the transport)
+ * and is counted, messages are only dropped when the ring is full after stop()
+ */
+class ShardedReceiver {
+public:
+    using handler_t = std::function<void(const received_message&)>;
+
+    /**
+     * @param cpus the core of every shard, shard i is on core i % cores when not given
+     */
+    ShardedReceiver(size_t shards, handler_t handler, std::vector<int> cpus = {}, size_t size = SHARD_QUEUE_SIZE)
+        : handler_(std::move(handler)) {
+        auto cores = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < std::max<size_t>(shards, 1); i++) {
+            shards_.push_back(std::make_unique<shard_s>(roundUpPow2(size)));
+            shards_.back()->cpu = i < cpus.size() ? cpus[i] : static_cast<int>(i % cores);
+        }
+    }
+
+    ~ShardedReceiver() {
+        stop();
+    }
+
+    ShardedReceiver(const ShardedReceiver&) = delete;
+    ShardedReceiver& operator=(const ShardedReceiver&) = delete;
+
+    auto start() -> void {
+        running_.store(true);
+        for (auto &shard : shards_) {
+            shard->worker = std::thread([this, s = shard.get()]() { run(*s); });
+        }
+    }
+
+    /**
+     * process what is left in the rings and stop the workers, the listeners are unregistered before
+     */
+    auto stop() -> void {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        for (auto &shard : shards_) {
+            wake(*shard);
+            shard->worker.join();
+        }
+    }
+
+    inline auto shardOf(uint32_t key) const -> size_t {
+        // Fibonacci hashing, the keys of the topics of an entity are consecutive
+        return static_cast<size_t>((key * 0x9e3779b97f4a7c15ULL) >> 32) % shards_.size();
+    }
+
+    inline auto shards() const -> size_t {
+        return shards_.size();
+    }
+
+    /**
+     * called by the transport thread, copies the payload to the shard of key
+     */
+    auto push(uint32_t key, const uint8_t *data, size_t size) -> void {
+        auto &shard = *shards_[shardOf(key)];
+        struct timespec received{};
+        clock_gettime(CLOCK_MONOTONIC, &received);
+        while (shard.producer.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        auto head = shard.head.load(std::memory_order_relaxed);
+        if (head - shard.tail_cache == shard.cells.size()) {
+            shard.tail_cache = shard.tail.load(std::memory_order_acquire);
+            if (head - shard.tail_cache == shard.cells.size()) {
+                shard.full.fetch_add(1, std::memory_order_relaxed);
+                while (head - (shard.tail_cache = shard.tail.load(std::memory_order_acquire)) == shard.cells.size()) {
+                    if (!running_.load(std::memory_order_relaxed)) {
+                        shard.dropped.fetch_add(1, std::memory_order_relaxed);
+                        shard.producer.clear(std::memory_order_release);
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+        }
+        auto &cell = shard.cells[head & shard.mask];
+        cell.key = key;
+        cell.data.assign(data, data + size);
+        cell.received = received;
+        // the depth with the current tail, taken before the cell is published so the tail can't pass head + 1
+        shard.tail_cache = shard.tail.load(std::memory_order_acquire);
+        auto depth = head + 1 - shard.tail_cache;
+        shard.head.store(head + 1, std::memory_order_release);
+        if (depth > shard.max_depth.load(std::memory_order_relaxed)) {
+            shard.max_depth.store(depth, std::memory_order_relaxed);
+        }
+        shard.producer.clear(std::memory_order_release);
+        // pairs with the store of sleeping in run(), one of the two sees the other
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (shard.sleeping.load(std::memory_order_relaxed)) {
+            wake(shard);
+        }
+    }
+
+    auto metrics() -> std::vector<shard_metrics> {
+        std::vector<shard_metrics> res {};
+        for (auto const &shard : shards_) {
+            shard_metrics m {};
+            m.cpu = shard->cpu;
+            m.pinned = shard->pinned.load(std::memory_order_relaxed);
+            m.full = shard->full.load(std::memory_order_relaxed);
+            m.dropped = shard->dropped.load(std::memory_order_relaxed);
+            m.max_depth = shard->max_depth.load(std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(shard->stats_mutex);
+            m.processed = shard->processed;
+            m.delay_mean = shard->processed > 0 ? shard->delay_sum / shard->processed : 0.0;
+            m.delay_max = shard->delay_max;
+            res.push_back(m);
+        }
+        return res;
+    }
+
+private:
+    struct cell_s {
+        uint32_t key = 0;
+        std::vector<uint8_t> data {}; // keeps its capacity, the cell is reused every size messages
+        struct timespec received {};
+    };
+
+    struct shard_s {
+        explicit shard_s(size_t size) : cells(size), mask(size - 1) {}
+
+        std::vector<cell_s> cells;
+        size_t mask;
+        alignas(64) std::atomic<size_t> head {0};
+        size_t tail_cache = 0; // the producer's copy of tail, under the producer flag
+        std::atomic_flag producer = ATOMIC_FLAG_INIT;
+        std::atomic<uint64_t> full {0};
+        std::atomic<uint64_t> dropped {0};
+        std::atomic<size_t> max_depth {0};
+        alignas(64) std::atomic<size_t> tail {0};
+        std::atomic<bool> sleeping {false};
+        std::mutex sleep_mutex {};
+        std::condition_variable sleep_cv {};
+        std::mutex stats_mutex {}; // written by the worker only, read by metrics()
+        uint64_t processed = 0;
+        double delay_sum = 0;
+        double delay_max = 0;
+        int cpu = 0;
+        std::atomic<bool> pinned {false};
+        std::thread worker {};
+    };
+
+    static auto roundUpPow2(size_t size) -> size_t {
+        size_t res = 2;
+        while (res < size) {
+            res <<= 1;
+        }
+        return res;
+    }
+
+    static inline auto getDelay(const struct timespec &end, const struct timespec &start) -> double {
+        return static_cast<double>(end.tv_sec - start.tv_sec) + static_cast<double>(end.tv_nsec - start.tv_nsec) * 1.0e-9;
+    }
+
+    static auto wake(shard_s &shard) -> void {
+        std::lock_guard<std::mutex> lock(shard.sleep_mutex);
+        shard.sleep_cv.notify_one();
+    }
+
+    auto run(shard_s &shard) -> void {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(shard.cpu, &set);
+        shard.pinned.store(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0, std::memory_order_relaxed);
+        size_t head_cache = 0;
+        int idle = 0;
+        while (true) {
+            auto tail = shard.tail.load(std::memory_order_relaxed);
+            if (tail == head_cache) {
+                head_cache = shard.head.load(std::memory_order_acquire);
+            }
+            if (tail != head_cache) {
+                auto &cell = shard.cells[tail & shard.mask];
+                handler_({cell.key, cell.data.data(), cell.data.size(), cell.received});
+                struct timespec now{};
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                auto delay = getDelay(now, cell.received);
+                shard.tail.store(tail + 1, std::memory_order_release);
+                std::lock_guard<std::mutex> lock(shard.stats_mutex);
+                shard.processed++;
+                shard.delay_sum += delay;
+                shard.delay_max = std::max(shard.delay_max, delay);
+                idle = 0;
+                continue;
+            }
+            if (!running_.load()) {
+                break;
+            }
+            if (++idle < SHARD_IDLE_SPINS) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(shard.sleep_mutex);
+            shard.sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // a producer that pushed before it saw sleeping is caught by the check under the lock
+            if (shard.head.load(std::memory_order_acquire) == shard.tail.load(std::memory_order_relaxed) && running_.load()) {
+                shard.sleep_cv.wait_for(lock, std::chrono::milliseconds(10));
+            }
+            shard.sleeping.store(false, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+
+    handler_t handler_;
+    std::vector<std::unique_ptr<shard_s>> shards_ {};
+    std::atomic<bool> running_ {false};
+};
+
+/**
+ * the listener of a topic, only hands the payload to the receiver
+ */
+class ShardedListener : public uprotocol::utransport::UListener {
+public:
+    ShardedListener(ShardedReceiver &receiver, uint32_t key) : receiver_(receiver), key_(key) {}
+
+    uprotocol::v1::UStatus onReceive(uprotocol::utransport::UMessage &umsg) override {
+        uprotocol::v1::UStatus status;
+        auto payload = umsg.payload();
+        receiver_.push(key_, payload.data(), payload.size());
+        status.set_code(uprotocol::v1::UCode::OK);
+        return status;
+    }
+
+private:
+    ShardedReceiver &receiver_;
+    uint32_t key_;
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_SHARDEDRECEIVER_H
@@ -0,0 +1,436 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_STREAMLOG_H
+#define UP_ZENOH_EXAMPLE_CPP_STREAMLOG_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <up-cpp/transport/UListener.h>
+#include <up-cpp/transport/UTransport.h>
+#include <up-cpp/transport/datamodel/UMessage.h>
+#include <up-cpp/uuid/factory/Uuidv8Factory.h>
+
+#include "UuidPool.h"
+
+constexpr uint32_t STREAM_LOG_MAGIC = 0x4c535055; // "UPSL"
+constexpr uint32_t STREAM_LOG_VERSION = 1;
+constexpr size_t STREAM_LOG_HEADER_SIZE = 4096; // one page, the records start after it
+constexpr size_t STREAM_LOG_WINDOW = 64 * 1024 * 1024; // mapped at a time, the file grows by this much
+
+/**
+ * | header (one page) | record | record | ...
+ * a record is a stream_record_header, the serialized UAttributes and the payload, padded to 8 bytes.
+ * end is written after every record so a log whose recorder died is readable up to the last complete record
+ */
+struct stream_log_header {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint64_t> end; // offset after the last complete record
+    std::atomic<uint64_t> records;
+    int64_t started; // CLOCK_REALTIME of the first record in ns, the context of the capture
+};
+
+struct stream_record_header {
+    uint32_t size; // of the record with the padding
+    uint32_t attributes_size;
+    uint32_t payload_size;
+    uint32_t reserved;
+    int64_t received; // CLOCK_MONOTONIC in ns
+};
+
+/**
+ * a record of the log, the pointers are into the mapping and valid until the next call of next()
+ */
+struct stream_record {
+    int64_t received;
+    const uint8_t *attributes;
+    size_t attributes_size;
+    const uint8_t *payload;
+    size_t payload_size;
+};
+
+static inline auto getMonotonicNs() -> int64_t {
+    struct timespec tm{};
+    clock_gettime(CLOCK_MONOTONIC, &tm);
+    return static_cast<int64_t>(tm.tv_sec) * 1000000000LL + tm.tv_nsec;
+}
+
+/**
+ * the part of the file that is mapped, a window of STREAM_LOG_WINDOW bytes (or the size of a bigger record)
+ * that moves with the position so a log of any size is written and read with a bounded mapping
+ */
+class StreamLogWindow {
+public:
+    ~StreamLogWindow() {
+        unmap();
+    }
+
+    /**
+     * @return the address of [offset, offset + size) or nullptr when it can't be mapped
+     */
+    auto at(int fd, uint64_t offset, size_t size, bool writable) -> uint8_t* {
+        if (ptr_ == nullptr || offset < offset_ || offset + size > offset_ + size_) {
+            unmap();
+            auto page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            auto start = offset & ~(page - 1);
+            auto length = std::max<uint64_t>(STREAM_LOG_WINDOW, offset + size - start);
+            auto ptr = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, start);
+            if (ptr == MAP_FAILED) {
+                return nullptr;
+            }
+            if (!writable) {
+                madvise(ptr, length, MADV_SEQUENTIAL);
+            }
+            ptr_ = static_cast<uint8_t*>(ptr);
+            offset_ = start;
+            size_ = length;
+        }
+        return ptr_ + (offset - offset_);
+    }
+
+    auto unmap() -> void {
+        if (ptr_ != nullptr) {
+            munmap(ptr_, size_);
+            ptr_ = nullptr;
+        }
+    }
+
+    inline auto end() const -> uint64_t {
+        return ptr_ == nullptr ? 0 : offset_ + size_;
+    }
+
+private:
+    uint8_t *ptr_ = nullptr;
+    uint64_t offset_ = 0;
+    size_t size_ = 0;
+};
+
+/**
+ * appends the messages of one or more topics to a log file, the file grows by STREAM_LOG_WINDOW and is cut to
+ * the last record on close(), safe from several listener threads
+ */
+class StreamRecorder {
+public:
+    explicit StreamRecorder(const std::string &path) {
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            return;
+        }
+        file_size_ = STREAM_LOG_HEADER_SIZE + STREAM_LOG_WINDOW;
+        auto header = ftruncate(fd_, file_size_) == 0 ?
+                      mmap(nullptr, STREAM_LOG_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0) : MAP_FAILED;
+        if (header == MAP_FAILED) {
+            ::close(fd_);
+            fd_ = -1;
+            return;
+        }
+        header_ = new (header) stream_log_header();
+        header_->magic = STREAM_LOG_MAGIC;
+        header_->version = STREAM_LOG_VERSION;
+        header_->end.store(STREAM_LOG_HEADER_SIZE);
+        end_ = STREAM_LOG_HEADER_SIZE;
+    }
+
+    ~StreamRecorder() {
+        close();
+    }
+
+    StreamRecorder(const StreamRecorder&) = delete;
+    StreamRecorder& operator=(const StreamRecorder&) = delete;
+
+    inline auto isOpen() const -> bool {
+        return header_ != nullptr;
+    }
+
+    /**
+     * the attributes are serialized straight into the mapping
+     * @return false when the log is closed or the file can't grow
+     */
+    auto append(const uprotocol::v1::UAttributes &attributes, const uint8_t *data, size_t size, int64_t received) -> bool {
+        auto attributes_size = attributes.ByteSizeLong();
+        auto record_size = (sizeof(stream_record_header) + attributes_size + size + 7) & ~static_cast<size_t>(7);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (header_ == nullptr) {
+            return false;
+        }
+        if (end_ + record_size > file_size_) {
+            file_size_ = std::max(file_size_ + STREAM_LOG_WINDOW, end_ + record_size);
+            if (ftruncate(fd_, file_size_) != 0) {
+                return false;
+            }
+        }
+        auto ptr = window_.at(fd_, end_, record_size, true);
+        if (ptr == nullptr) {
+            return false;
+        }
+        stream_record_header record {};
+        record.size = static_cast<uint32_t>(record_size);
+        record.attributes_size = static_cast<uint32_t>(attributes_size);
+        record.payload_size = static_cast<uint32_t>(size);
+        record.received = received;
+        std::memcpy(ptr, &record, sizeof(record));
+        attributes.SerializeToArray(ptr + sizeof(record), static_cast<int>(attributes_size));
+        if (size > 0) {
+            std::memcpy(ptr + sizeof(record) + attributes_size, data, size);
+        }
+        if (header_->records.load(std::memory_order_relaxed) == 0) {
+            struct timespec wall{};
+            clock_gettime(CLOCK_REALTIME, &wall);
+            header_->started = static_cast<int64_t>(wall.tv_sec) * 1000000000LL + wall.tv_nsec;
+        }
+        end_ += record_size;
+        header_->records.fetch_add(1, std::memory_order_relaxed);
+        header_->end.store(end_, std::memory_order_release);
+        return true;
+    }
+
+    auto records() const -> uint64_t {
+        return header_ == nullptr ? 0 : header_->records.load(std::memory_order_relaxed);
+    }
+
+    auto bytes() -> uint64_t {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return end_;
+    }
+
+    /**
+     * unmap and cut the file to the last record
+     */
+    auto close() -> void {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (header_ == nullptr) {
+            return;
+        }
+        window_.unmap();
+        munmap(header_, STREAM_LOG_HEADER_SIZE);
+        header_ = nullptr;
+        if (ftruncate(fd_, end_) != 0) {
+            // the log is still valid, the end in the header is the last record
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+private:
+    int fd_ = -1;
+    stream_log_header *header_ = nullptr;
+    uint64_t end_ = 0;
+    uint64_t file_size_ = 0;
+    StreamLogWindow window_ {};
+    std::mutex mutex_ {};
+};
+
+/**
+ * reads the records of a log in order through a moving read only mapping
+ */
+class StreamReader {
+public:
+    explicit StreamReader(const std::string &path) {
+        fd_ = open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            return;
+        }
+        struct stat st{};
+        if (fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < STREAM_LOG_HEADER_SIZE) {
+            return;
+        }
+        auto header = reinterpret_cast<const stream_log_header*>(window_.at(fd_, 0, STREAM_LOG_HEADER_SIZE, false));
+        if (header == nullptr || header->magic != STREAM_LOG_MAGIC || header->version != STREAM_LOG_VERSION) {
+            return;
+        }
+        // the end of a log that is still recorded only moves forward, the records up to it are complete
+        end_ = std::min<uint64_t>(header->end.load(std::memory_order_acquire), st.st_size);
+        records_ = header->records.load(std::memory_order_relaxed);
+        started_ = header->started;
+        pos_ = STREAM_LOG_HEADER_SIZE;
+        open_ = true;
+    }
+
+    ~StreamReader() {
+        window_.unmap();
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    StreamReader(const StreamReader&) = delete;
+    StreamReader& operator=(const StreamReader&) = delete;
+
+    inline auto isOpen() const -> bool {
+        return open_;
+    }
+
+    inline auto records() const -> uint64_t {
+        return records_;
+    }
+
+    inline auto bytes() const -> uint64_t {
+        return end_;
+    }
+
+    inline auto started() const -> int64_t {
+        return started_;
+    }
+
+    auto rewind() -> void {
+        pos_ = STREAM_LOG_HEADER_SIZE;
+    }
+
+    /**
+     * @return false at the end of the log or at a damaged record
+     */
+    auto next(stream_record &record) -> bool {
+        if (!open_ || pos_ + sizeof(stream_record_header) > end_) {
+            return false;
+        }
+        auto ptr = window_.at(fd_, pos_, sizeof(stream_record_header), false);
+        if (ptr == nullptr) {
+            return false;
+        }
+        stream_record_header header {};
+        std::memcpy(&header, ptr, sizeof(header));
+        if (header.size < sizeof(header) + header.attributes_size + header.payload_size || pos_ + header.size > end_) {
+            return false;
+        }
+        ptr = window_.at(fd_, pos_, header.size, false);
+        if (ptr == nullptr) {
+            return false;
+        }
+        record.received = header.received;
+        record.attributes = ptr + sizeof(header);
+        record.attributes_size = header.attributes_size;
+        record.payload = record.attributes + header.attributes_size;
+        record.payload_size = header.payload_size;
+        pos_ += header.size;
+        return true;
+    }
+
+private:
+    int fd_ = -1;
+    bool open_ = false;
+    uint64_t end_ = 0;
+    uint64_t pos_ = 0;
+    uint64_t records_ = 0;
+    int64_t started_ = 0;
+    StreamLogWindow window_ {};
+};
+
+/**
+ * the listener of a recorded topic
+ */
+class RecordingListener : public uprotocol::utransport::UListener {
+public:
+    explicit RecordingListener(StreamRecorder &recorder) : recorder_(recorder) {}
+
+    uprotocol::v1::UStatus onReceive(uprotocol::utransport::UMessage &umsg) override {
+        auto received = getMonotonicNs();
+        uprotocol::v1::UStatus status;
+        auto payload = umsg.payload();
+        status.set_code(recorder_.append(umsg.attributes(), payload.data(), payload.size(), received) ?
+                        uprotocol::v1::UCode::OK : uprotocol::v1::UCode::RESOURCE_EXHAUSTED);
+        return status;
+    }
+
+private:
+    StreamRecorder &recorder_;
+};
+
+struct replay_stat {
+    uint64_t messages;
+    uint64_t errors; // failed sends
+    uint64_t skipped; // records whose attributes can't be parsed
+    uint64_t bytes;
+    double duration;
+    double lag_mean; // send start after the deadline of the record, in seconds
+    double lag_max;
+};
+
+/**
+ * publishes the records of the log with the recorded attributes and payload, every message gets a new id.
+ * speed 1.0 keeps the recorded gaps, 2.0 halves them and 0 sends as fast as possible.
+ * on_send(record, send duration, lag) is called after every send
+ */
+template<typename T, typename F>
+static inline auto replayStream(StreamReader &reader, uprotocol::utransport::UTransport &transport, double speed,
+                                T &&terminate, F &&on_send) -> replay_stat {
+    replay_stat res {};
+    uprotocol::v1::UAttributes attributes {};
+    stream_record record {};
+    int64_t first = 0;
+    bool has_first = false;
+    auto start = getMonotonicNs();
+    while (!terminate() && reader.next(record)) {
+        if (!attributes.ParseFromArray(record.attributes, static_cast<int>(record.attributes_size))) {
+            res.skipped++;
+            continue;
+        }
+        if (!has_first) {
+            first = record.received;
+            has_first = true;
+        }
+        double lag = 0.0;
+        if (speed > 0.0) {
+            auto deadline = start + static_cast<int64_t>((record.received - first) / speed);
+            struct timespec tm{};
+            tm.tv_sec = deadline / 1000000000LL;
+            tm.tv_nsec = deadline % 1000000000LL;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tm, nullptr) == EINTR && !terminate()) {
+            }
+            lag = std::max<int64_t>(0, getMonotonicNs() - deadline) * 1.0e-9;
+        }
+        *attributes.mutable_id() = UuidPool::local().next();
+        uprotocol::utransport::UPayload payload(record.payload, record.payload_size, uprotocol::utransport::UPayloadType::VALUE);
+        uprotocol::utransport::UMessage umsg(payload, attributes);
+        auto send_start = getMonotonicNs();
+        auto status = transport.send(umsg);
+        auto send_duration = (getMonotonicNs() - send_start) * 1.0e-9;
+        if (uprotocol::v1::UCode::OK != status.code()) {
+            res.errors++;
+            continue;
+        }
+        res.messages++;
+        res.bytes += record.payload_size;
+        res.lag_mean += (lag - res.lag_mean) / res.messages;
+        res.lag_max = std::max(res.lag_max, lag);
+        on_send(record, send_duration, lag);
+    }
+    res.duration = (getMonotonicNs() - start) * 1.0e-9;
+    return res;
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_STREAMLOG_H
@@ -0,0 +1,296 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_TRACE_H
+#define UP_ZENOH_EXAMPLE_CPP_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+constexpr size_t TRACE_CAPACITY = 1 << 16; // events per thread, the oldest are overwritten
+const std::string TRACE_ENV = "UP_TRACE";
+const std::string TRACE_PREFIX = "trace-";
+
+/**
+ * one fixed size binary event, name is a string literal so recording copies a pointer and never allocates
+ * phase is the Chrome trace phase: 'X' a stage with a duration, 'i' an instant, 's' / 'f' the start and the
+ * end of the flow of a message from the publisher to the subscriber (same id in both processes)
+ */
+struct trace_event {
+    int64_t start; // CLOCK_MONOTONIC in ns, the same clock in all the processes of the host
+    int64_t duration;
+    const char *name;
+    uint64_t id;
+    char phase;
+};
+
+/**
+ * the trace of a process, every thread appends to its own ring so recording takes no lock,
+ * a thread registers its ring on its first event. disabled (the default) an event is one relaxed load.
+ * write() exports Chrome trace JSON for chrome://tracing, ui.perfetto.dev or speedscope,
+ * it is called when the threads stopped recording
+ */
+class Tracer {
+public:
+    static auto instance() -> Tracer& {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    static inline auto enabled() -> bool {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * tracing is on when UP_TRACE is set to anything but 0
+     */
+    static auto enabledByEnv() -> bool {
+        auto env = std::getenv(TRACE_ENV.c_str());
+        return env != nullptr && std::string(env) != "" && std::string(env) != "0";
+    }
+
+    auto enable(size_t capacity = TRACE_CAPACITY) -> void {
+        capacity_ = capacity;
+        enabled_.store(true);
+    }
+
+    auto disable() -> void {
+        enabled_.store(false);
+    }
+
+    static inline auto now() -> int64_t {
+        struct timespec tm{};
+        clock_gettime(CLOCK_MONOTONIC, &tm);
+        return static_cast<int64_t>(tm.tv_sec) * 1000000000LL + tm.tv_nsec;
+    }
+
+    inline auto record(const char *name, char phase, int64_t start, int64_t duration, uint64_t id) -> void {
+        auto &buffer = threadBuffer();
+        auto &event = buffer.events[buffer.next++ & (buffer.events.size() - 1)];
+        event.start = start;
+        event.duration = duration;
+        event.name = name;
+        event.id = id;
+        event.phase = phase;
+    }
+
+    /**
+     * the name of the calling thread in the viewer
+     */
+    auto nameThread(const std::string &name) -> void {
+        if (enabled()) {
+            auto &buffer = threadBuffer();
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffer.name = name;
+        }
+    }
+
+    /**
+     * @return false when the file can't be written
+     */
+    auto write(const std::string &path, const std::string &process_name) -> bool {
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto pid = getpid();
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":0,\"args\":{\"name\":\""
+            << process_name << "\"}}";
+        char ts[64];
+        char id[32];
+        for (auto const &buffer : buffers_) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                << ",\"args\":{\"name\":\"" << (buffer->name.empty() ? std::to_string(buffer->tid) : buffer->name) << "\"}}";
+            auto size = buffer->events.size();
+            auto first = buffer->next > size ? buffer->next - size : 0;
+            for (auto i = first; i < buffer->next; i++) {
+                auto const &event = buffer->events[i & (size - 1)];
+                // microseconds with the ns as decimals
+                snprintf(ts, sizeof(ts), "%lld.%03lld", static_cast<long long>(event.start / 1000),
+                         static_cast<long long>(event.start % 1000));
+                out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << ts
+                    << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid;
+                if (event.phase == 'X') {
+                    snprintf(ts, sizeof(ts), "%lld.%03lld", static_cast<long long>(event.duration / 1000),
+                             static_cast<long long>(event.duration % 1000));
+                    out << ",\"dur\":" << ts;
+                }
+                // the id is a hex string, a JSON number above 2^53 loses its low bits in the viewers
+                snprintf(id, sizeof(id), "\"0x%llx\"", static_cast<unsigned long long>(event.id));
+                if (event.phase == 's' || event.phase == 'f') {
+                    out << ",\"cat\":\"message\",\"id\":" << id << (event.phase == 'f' ? ",\"bp\":\"e\"" : "");
+                } else if (event.phase == 'i') {
+                    out << ",\"s\":\"t\"";
+                }
+                out << ",\"args\":{\"id\":" << id << "}}";
+            }
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+    /**
+     * the events that were overwritten in all the threads
+     */
+    auto overwritten() -> uint64_t {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t res = 0;
+        for (auto const &buffer : buffers_) {
+            res += buffer->next > buffer->events.size() ? buffer->next - buffer->events.size() : 0;
+        }
+        return res;
+    }
+
+private:
+    struct thread_buffer_s {
+        std::vector<trace_event> events;
+        uint64_t next = 0;
+        uint32_t tid = 0;
+        std::string name {};
+    };
+
+    Tracer() = default;
+
+    inline auto threadBuffer() -> thread_buffer_s& {
+        static thread_local thread_buffer_s *buffer = nullptr;
+        if (buffer == nullptr) {
+            size_t size = 2;
+            while (size < capacity_) {
+                size <<= 1;
+            }
+            // owned by the tracer, the events of a thread that exited are still exported
+            auto res = std::make_unique<thread_buffer_s>();
+            res->events.resize(size);
+            res->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffer = res.get();
+            buffers_.push_back(std::move(res));
+        }
+        return *buffer;
+    }
+
+    static inline std::atomic<bool> enabled_ {false};
+    size_t capacity_ = TRACE_CAPACITY;
+    std::mutex mutex_ {};
+    std::vector<std::unique_ptr<thread_buffer_s>> buffers_ {};
+};
+
+/**
+ * a stage of the message, from the constructor to the destructor
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char *name, uint64_t id = 0) : name_(name), id_(id) {
+        if (Tracer::enabled()) {
+            start_ = Tracer::now();
+        }
+    }
+
+    ~TraceScope() {
+        if (start_ != 0) {
+            Tracer::instance().record(name_, 'X', start_, Tracer::now() - start_, id_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char *name_;
+    uint64_t id_;
+    int64_t start_ = 0;
+};
+
+static inline auto traceInstant(const char *name, uint64_t id = 0) -> void {
+    if (Tracer::enabled()) {
+        Tracer::instance().record(name, 'i', Tracer::now(), 0, id);
+    }
+}
+
+/**
+ * a stage that was already timed with CLOCK_MONOTONIC
+ */
+static inline auto traceSpan(const char *name, const struct timespec &start, const struct timespec &end, uint64_t id = 0) -> void {
+    if (Tracer::enabled()) {
+        auto from = static_cast<int64_t>(start.tv_sec) * 1000000000LL + start.tv_nsec;
+        auto to = static_cast<int64_t>(end.tv_sec) * 1000000000LL + end.tv_nsec;
+        Tracer::instance().record(name, 'X', from, to - from, id);
+    }
+}
+
+/**
+ * the arrow from the send of a message to its callback, start in the publisher and end in the subscriber
+ */
+static inline auto traceFlow(const char *name, uint64_t id, bool start) -> void {
+    if (Tracer::enabled()) {
+        Tracer::instance().record(name, start ? 's' : 'f', Tracer::now(), 0, id);
+    }
+}
+
+/**
+ * the flow id of a message of the benchmarks, the same in the publisher and in the subscriber:
+ * 16 bits of publisher, 16 bits of topic index (the test plan has up to 65536 topics) and the sequence
+ */
+static inline auto traceMessageId(uint32_t publisher, uint32_t topic_index, uint32_t sequence) -> uint64_t {
+    return (static_cast<uint64_t>(publisher & 0xffff) << 48) | (static_cast<uint64_t>(topic_index & 0xffff) << 32) | sequence;
+}
+
+/**
+ * the events of the traces of several processes (written by Tracer::write) in one trace, the processes are
+ * lined up since they all use CLOCK_MONOTONIC
+ */
+static inline auto mergeTraces(const std::vector<std::filesystem::path> &files) -> std::string {
+    std::string res = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (auto const &file : files) {
+        std::ifstream in(file);
+        std::string trace((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        auto begin = trace.find('[');
+        auto end = trace.rfind(']');
+        if (begin == std::string::npos || end == std::string::npos || end <= begin + 1) {
+            continue;
+        }
+        res += first ? "" : ",";
+        res += trace.substr(begin + 1, end - begin - 1);
+        first = false;
+    }
+    res += "]}\n";
+    return res;
+}
+
+#endif //UP_ZENOH_EXAMPLE_CPP_TRACE_H
@@ -0,0 +1,132 @@
+// /*
+//  * Copyright (c) 2024 General Motors GTO LLC
+//  *
+//  * Licensed to the Apache Software Foundation (ASF) under one
+//  * or more contributor license agreements.  See the NOTICE file
+//  * distributed with this work for additional information
+//  * regarding copyright ownership.  The ASF licenses this file
+//  * to you under the Apache License, Version 2.0 (the
+//  * "License"); you may not use this file except in compliance
+//  * with the License.  You may obtain a copy of the License at
+//  *
+//  *   http://www.apache.org/licenses/LICENSE-2.0
+//  *
+//  * Unless required by applicable law or agreed to in writing,
+//  * software distributed under the License is distributed on an
+//  * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+//  * KIND, either express or implied.  See the License for the
+//  * specific language governing permissions and limitations
+//  * under the License.
+//  * SPDX-FileType: SOURCE
+//  * SPDX-FileCopyrightText: 2024 General Motors GTO LLC
+//  * SPDX-License-Identifier: Apache-2.0
+//  *
+//
+
+#ifndef UP_ZENOH_EXAMPLE_CPP_UUIDPOOL_H
+#define UP_ZENOH_EXAMPLE_CPP_UUIDPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <time.h>
+
+#include <up-core-api/uattributes.pb.h>
+
+constexpr size_t UUID_POOL_BATCH = 64;
+constexpr uint64_t UUID_COUNTER_BITS = 12;
+constexpr uint64_t UUID_VERSION_8 = 8ULL << 12;
+constexpr uint64_t UUID_VARIANT_RFC4122 = 2ULL << 62;
+
+/**
+ * the UUIDv8 ids of the messages of a thread without a call of Uuidv8Factory::create per message.
+ * the uProtocol UUIDv8 is msb = 48 bits unix time in ms | version 8 | 12 bits counter in the ms and
+ * lsb = variant | 62 random bits. the pool of a thread reserves a batch of counters of the current ms from
+ * the process (one compare and swap), the ids of the batch are then handed out with a clock read and no
+ * atomic, lock or random number. a batch is dropped when the clock moved to the next ms, so the time of an id is
+ * never before the time it was taken and the ids of the process keep increasing in the order of the reservations,
+ * the ids of a thread in the order they are taken. when the 4096 counters of a ms are used the next batch is
+ * in the next ms.
+ * the random part is drawn once per process, not the one of Uuidv8Factory, so the ids of the pool never collide
+ * with the ids that the factory creates in the same ms
+ */
+class UuidPool {
+public:
+    explicit UuidPool(size_t batch = UUID_POOL_BATCH) : batch_(batch == 0 ? 1 : batch) {}
+
+    /**
+     * the pool of the calling thread
+     */
+    static auto local() -> UuidPool& {
+        static thread_local UuidPool pool;
+        return pool;
+    }
+
+    inline auto next() -> uprotocol::v1::UUID {
+        auto now = nowMs();
+        if (next_ == end_ || (next_ >> UUID_COUNTER_BITS) < now) {
+            reserve(now);
+        }
+        uprotocol::v1::UUID res;
+        auto tick = next_++;
+        ids_++;
+        res.set_msb(((tick >> UUID_COUNTER_BITS) << 16) | UUID_VERSION_8 | (tick & ((1ULL << UUID_COUNTER_BITS) - 1)));
+        res.set_lsb(lsb());
+        return res;
+    }
+
+    /**
+     * the reservations of this pool, ids / batches is how many ids a batch gave before the clock moved on
+     */
+    auto batches() const -> uint64_t {
+        return batches_;
+    }
+
+    auto ids() const -> uint64_t {
+        return ids_;
+    }
+
+private:
+    static inline auto nowMs() -> uint64_t {
+        struct timespec tm{};
+        clock_gettime(CLOCK_REALTIME, &tm);
+        return static_cast<uint64_t>(tm.tv_sec) * 1000 + static_cast<uint64_t>(tm.tv_nsec) / 1000000;
+    }
+
+    static auto lsb() -> uint64_t {
+        static const uint64_t lsb = [] {
+            std::random_device device;
+            auto random = (static_cast<uint64_t>(device()) << 32) | device();
+            return UUID_VARIANT_RFC4122 | (random >> 2);
+        }();
+        return lsb;
+    }
+
+    /**
+     * a tick is the ms and the counter in one number, the next free tick of the process only goes up
+     */
+    auto reserve(uint64_t now) -> void {
+        auto tick = last_tick_.load(std::memory_order_relaxed);
+        uint64_t from = 0;
+        uint64_t to = 0;
+        do {
+            from = std::max(tick, now << UUID_COUNTER_BITS);
+            // a batch doesn't cross a ms, its ids have the time they were reserved at
+            auto ms_end = ((from >> UUID_COUNTER_BITS) + 1) << UUID_COUNTER_BITS;
+            to = std::min<uint64_t>(from + batch_, ms_end);
+        } while (!last_tick_.compare_exchange_weak(tick, to, std::memory_order_relaxed));
+        next_ = from;
+        end_ = to;
+        batches_++;
+    }
+
+    static inline std::atomic<uint64_t> last_tick_ {0};
+    size_t batch_;
+    uint64_t next_ = 0;
+    uint64_t end_ = 0;
+    uint64_t batches_ = 0;
+    uint64_t ids_ = 0;
+};
+
+#endif //UP_ZENOH_EXAMPLE_CPP_UUIDPOOL_H
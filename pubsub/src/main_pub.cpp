@@ -38,6 +38,11 @@
 #include <up-core-api/ustatus.pb.h>
 #include <up-core-api/uri.pb.h>
 #include "uri.h"
+#include "SessionPool.h"
+#include "Locator.h"
+#include "Coalescer.h"
+#include "PeriodicScheduler.h"
+#include "AsyncPublisher.h"
 
 using namespace uprotocol::utransport;
 using namespace uprotocol::uri;
@@ -48,6 +53,10 @@ const std::string TIME_URI_STRING = "/test.app/1/milliseconds";
 const std::string RANDOM_URI_STRING = "/test.app/1/32bit";
 const std::string COUNTER_URI_STRING = "/test.app/1/counter";
 
+constexpr int64_t TIME_PERIOD_NS = 100000000; // 100 ms
+constexpr int64_t RANDOM_PERIOD_NS = 10000000; // 10 ms
+constexpr int64_t COUNTER_PERIOD_NS = 1000000; // 1 ms
+
 bool gTerminate = false;
 
 void signalHandler(int signal) {
@@ -83,40 +92,6 @@ static inline std::uint8_t* getCounter() {
 }
 
 
-class Publisher : public  ZenohUTransport {
-public :
-    Publisher(ZenohSessionManagerConfig &config) : ZenohUTransport(config) {
-    }
-    
-    UCode sendMessage(UUri &uri,
-                      std::uint8_t *buffer,
-                      size_t size) {
-        
-        auto uuid = Uuidv8Factory::create();
-        
-        UAttributesBuilder builder(uri, uuid, UMessageType::UMESSAGE_TYPE_PUBLISH, UPriority::UPRIORITY_CS2);
-        UAttributes attributes = builder.build();
-        
-        UPayload payload(buffer, size, UPayloadType::VALUE);
-        
-        UMessage umsg(payload, attributes);
-        
-        //virtual uprotocol::v1::UStatus send(const uprotocol::utransport::UMessage &message) = 0;
-        UStatus status = send(umsg);
-        if (UCode::OK != status.code()) {
-            spdlog::error("send.send failed");
-            return UCode::UNAVAILABLE;
-        }
-        return UCode::OK;
-    }
-    
-    inline auto getSuccess() -> uprotocol::v1::UStatus {
-      return uSuccess_;
-    }
-    
-    ~Publisher() {
-    }
-};
 /* The sample pub applications demonstrates how to send data using uTransport -
  * There are three topics that are published - random number, current time and a counter */
 int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv) {
@@ -125,7 +100,7 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv) {
     
     ZenohSessionManagerConfig config{};
     //config.listenKey = "[\"unixpipe/pub.pipe\"]";
-    config.connectKey = "[\"unixpipe/pub.pipe\"]";
+    config.connectKey = getEndpointFromArgs(argc, argv);
     config.listenKey = "";
     //config.connectKey = "[\"unixpipe/pub.pipe\"]";
     //config.listenKey = listen_key;
@@ -134,12 +109,8 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv) {
     config.lowLatency = "true";
     config.scouting_delay = 0;
     
-    
-    Publisher *pub = new Publisher(config); 
-    if (UCode::OK != (pub->getSuccess()).code()) {
-        spdlog::error("ZenohUTransport init failed");
-        return -1;
-    }
+    /* the session is opened in the background while the URIs are built */
+    SessionPool::instance().prepare(config);
     
     /* Create URI objects from string URI*/
     //auto timeUri = LongUriSerializer::deserialize(TIME_URI_STRING);
@@ -148,31 +119,74 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv) {
     auto randomUri = buildMicrouri(rand_id, 1);
     //auto counterUri = LongUriSerializer::deserialize(COUNTER_URI_STRING);
     auto counterUri = buildMicrouri(count_id, 4);
-
-    while (!gTerminate) {
-        /* send current time in milliseconds */
-        if (UCode::OK != pub->sendMessage(timeUri, getTime(), 8)) {
-            spdlog::error("sendMessage failed");
-            break;
+    
+    auto session = SessionPool::instance().acquire(config);
+    if (nullptr == session) {
+        spdlog::error("ZenohUTransport init failed");
+        return -1;
+    }
+    /* pub [endpoint] [budget us] - with a latency budget the updates are coalesced into one message */
+    long budget_us = 0;
+    if (argc >= 3) {
+        budget_us = std::strtol(argv[2], nullptr, 10);
+    }
+    std::unique_ptr<CoalescingPublisher> coalescer;
+    if (budget_us > 0) {
+        coalescer = std::make_unique<CoalescingPublisher>(session, buildMicrouri(container_id, 1),
+                                                          std::chrono::microseconds(budget_us));
+    }
+    /* the scheduler thread only enqueues, the I/O thread of pub sends and a failed send is counted */
+    AsyncPublisher pub(*session);
+    auto timeTopic = pub.addTopic("time", timeUri, overflow_policy::KEEP_LATEST);
+    auto randomTopic = pub.addTopic("random", randomUri, overflow_policy::DROP_NEWEST);
+    auto counterTopic = pub.addTopic("counter", counterUri, overflow_policy::BLOCK, std::chrono::microseconds(500));
+    pub.start();
+    auto publish = [&](UUri &uri, size_t topic, std::uint8_t *buffer, size_t size) {
+        auto code = coalescer ? coalescer->update(uri, buffer, size) : pub.enqueue(topic, buffer, size);
+        if (UCode::OK != code) {
+            spdlog::debug("update of {} dropped", topic);
         }
+        return true;
+    };
 
+    /* every topic has its own rate, the scheduler keeps the periods on absolute deadlines */
+    PeriodicScheduler scheduler;
+    scheduler.add("time", TIME_PERIOD_NS, [&]() {
+        /* send current time in milliseconds */
+        return publish(timeUri, timeTopic, getTime(), 8);
+    });
+    scheduler.add("random", RANDOM_PERIOD_NS, [&]() {
         /* send random number */
-        if (UCode::OK != pub->sendMessage(randomUri, getRandom(), 4)) {
-            spdlog::error("sendMessage failed");
-            break;
-        }
-
+        return publish(randomUri, randomTopic, getRandom(), 4);
+    });
+    scheduler.add("counter", COUNTER_PERIOD_NS, [&]() {
         /* send counter */
-        if (UCode::OK != pub->sendMessage(counterUri, getCounter(), 1)) {
-            spdlog::error("sendMessage failed");
-            break;
-        }
-        
-        sleep(1);
+        return publish(counterUri, counterTopic, getCounter(), 1);
+    });
+    scheduler.run([]() { return gTerminate; });
+
+    for (auto const &stat : scheduler.stats()) {
+        spdlog::info("{} : period {} us, {} runs, {} missed, jitter mean {:.1f} us std {:.1f} us max {:.1f} us",
+                     stat.name, stat.period / 1000, stat.runs, stat.missed,
+                     stat.jitter_mean / 1000, stat.jitter_std / 1000, stat.jitter_max / 1000.0);
+    }
+    if (coalescer) {
+        coalescer->flush();
+        spdlog::info("{} updates in {} messages", coalescer->updatesSent(), coalescer->messagesSent());
+        coalescer.reset();
+    }
+    pub.stop();
+    auto metrics = pub.metrics();
+    spdlog::info("send queue : max depth {}", metrics.max_depth);
+    for (auto const &topic : metrics.topics) {
+        spdlog::info("{} : {} enqueued, {} sent, {} dropped, {} send errors, enqueue to send mean {:.1f} us max {:.1f} us",
+                     topic.name, topic.enqueued, topic.sent, topic.dropped, topic.send_errors,
+                     topic.latency_mean * 1.0e6, topic.latency_max * 1.0e6);
     }
 
      /* Terminate zenoh utransport */
-    delete pub;
+    session.reset();
+    SessionPool::instance().clear();
  
     return 0;
 }
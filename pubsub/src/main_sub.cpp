@@ -39,6 +39,11 @@
 #include <up-core-api/ustatus.pb.h>
 #include <up-core-api/uri.pb.h>
 #include "uri.h"
+#include "SessionPool.h"
+#include "Locator.h"
+#include "Coalescer.h"
+#include "ShardedReceiver.h"
+#include "LatestValueCache.h"
 
 using namespace uprotocol::utransport;
 using namespace uprotocol::uri;
@@ -59,6 +64,30 @@ void signalHandler(int signal) {
     }
 }
 
+/* the values of the three topics, the topic is the entity id of the source */
+static void logValue(int eid, const uint8_t *data) {
+    if (eid == time_id) {
+        const uint64_t *timeInMilliseconds = reinterpret_cast<const uint64_t *>(data);
+        spdlog::info("time = {}", *timeInMilliseconds);
+    } else if (eid == rand_id) {
+        const uint32_t *random = reinterpret_cast<const uint32_t *>(data);
+        spdlog::info("random = {}", *random);
+    } else if (eid == count_id) {
+        const uint8_t *counter = reinterpret_cast<const uint8_t *>(data);
+        spdlog::info("counter = {}", *counter);
+    }
+}
+
+/* the current value of every topic for the consumers that poll instead of listening (see LatestValueCache.h),
+ * the listener of a topic writes it from the topic and from the container topic, the cache serializes the writers */
+LatestValueCache gLatest(3);
+
+static void storeValue(int eid, const uint8_t *data, size_t size) {
+    if (auto index = gLatest.find(eid)) {
+        gLatest.write(*index, data, size);
+    }
+}
+
 class CustomListener : public UListener {
 
     public:
@@ -68,26 +97,11 @@ class CustomListener : public UListener {
         UStatus onReceive(UMessage &umsg) override {
             std::cout << "got message" << __func__ << ":" << __LINE__ << std::endl;
             auto payload = umsg.payload();
-            auto attributes = umsg.attributes();
+            /* the attributes are read in place, a copy allocates the source and its strings for every message */
+            const auto &attributes = umsg.attributes();
             if (attributes.has_source()) {
-                auto uri = attributes.source();
-                auto uuri = MicroUriSerializer::serialize(uri);
-                auto entity = uri.entity();
-                auto resource = uri.resource();
-                auto autority = uri.authority();
-                auto eid = entity.id();
-                //auto rid = resource.id();
-                
-                if (eid == time_id) {
-                    const uint64_t *timeInMilliseconds = reinterpret_cast<const uint64_t *>(payload.data());
-                    spdlog::info("time = {}", *timeInMilliseconds);
-                } else if (eid == rand_id) {
-                    const uint32_t *random = reinterpret_cast<const uint32_t *>(payload.data());
-                    spdlog::info("random = {}", *random);
-                } else if (eid == count_id) {
-                    const uint8_t *counter = reinterpret_cast<const uint8_t *>(payload.data());
-                    spdlog::info("counter = {}", *counter);
-                }
+                logValue(attributes.source().entity().id(), payload.data());
+                storeValue(attributes.source().entity().id(), payload.data(), payload.size());
             }
             UStatus status;
 
@@ -97,28 +111,13 @@ class CustomListener : public UListener {
         }
 };
 
-class Subscriber : public  ZenohUTransport {
-public:
-    
-    //Subscriber() : Subscriber(ZenohSessionManagerConfig()) {}
-    Subscriber(ZenohSessionManagerConfig &config) : ZenohUTransport(config) {}
-    //Subscriber(ZenohSessionManagerConfig config) : ZenohUTransport(config) {}
-    
-    inline auto getSuccess() -> uprotocol::v1::UStatus {
-        return uSuccess_;
-    }
-   
-    ~Subscriber() {
-    }
-    
-};
 /* The sample sub applications demonstrates how to consume data using uTransport -
  * There are three topics that are received - random number, current time and a counter */
 int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
 
     signal(SIGINT, signalHandler);
     ZenohSessionManagerConfig config{};
-    config.listenKey = "[\"unixpipe/pub.pipe\"]";
+    config.listenKey = getEndpointFromArgs(argc, argv);
     //config.connectKey = "[\"unixpipe/pub.pipe\"]";
     //config.listenKey = listen_key;
     config.connectKey = "";
@@ -126,17 +125,32 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
     config.lowLatency = "true";
     config.scouting_delay = 0;
     
-    auto sub = new Subscriber(config);
-    if (UCode::OK != (sub->getSuccess()).code()) {
-        spdlog::error("ZenohUTransport init failed");
-        return -1;
-    }
-    
+    /* the session is opened in the background while the listeners and URIs are built */
+    SessionPool::instance().prepare(config);
         
-    std::vector<std::unique_ptr<CustomListener>> listeners;
-    listeners.emplace_back(std::make_unique<CustomListener>());
-    listeners.emplace_back(std::make_unique<CustomListener>());
-    listeners.emplace_back(std::make_unique<CustomListener>());
+    auto timeIndex = gLatest.add(time_id).value();
+    auto randomIndex = gLatest.add(rand_id).value();
+    auto counterIndex = gLatest.add(count_id).value();
+
+    /* with a number of shards the callbacks only copy the payload and the values are logged by
+     * workers pinned to cores, the topics of a shard are logged in order (see ShardedReceiver.h) */
+    size_t shards = argc >= 3 ? std::strtoul(argv[2], nullptr, 10) : 0;
+    std::unique_ptr<ShardedReceiver> receiver {};
+    std::vector<std::unique_ptr<UListener>> listeners;
+    if (shards > 0) {
+        receiver = std::make_unique<ShardedReceiver>(shards, [](const received_message &msg) {
+            logValue(msg.key, msg.data);
+            storeValue(msg.key, msg.data, msg.size);
+        });
+        listeners.emplace_back(std::make_unique<ShardedListener>(*receiver, time_id));
+        listeners.emplace_back(std::make_unique<ShardedListener>(*receiver, rand_id));
+        listeners.emplace_back(std::make_unique<ShardedListener>(*receiver, count_id));
+        receiver->start();
+    } else {
+        listeners.emplace_back(std::make_unique<CustomListener>());
+        listeners.emplace_back(std::make_unique<CustomListener>());
+        listeners.emplace_back(std::make_unique<CustomListener>());
+    }
 
     const std::vector<std::string> uriStrings = {
         TIME_URI_STRING,
@@ -153,6 +167,12 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
     uris.push_back(randomUri);
     uris.push_back(counterUri);
 
+    auto sub = SessionPool::instance().acquire(config);
+    if (nullptr == sub) {
+        spdlog::error("ZenohUTransport init failed");
+        return -1;
+    }
+
     /* register listeners - in this example the same listener is used for three seperate topics */
     for (size_t i = 0; i < uris.size(); ++i) {
         auto status = sub->registerListener(uris[i], *listeners[i]);
@@ -162,10 +182,32 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
         }
     }
 
+    /* the updates coalesced by pub on the container topic go to the same listeners */
+    auto containerUri = buildMicrouri(container_id, 1);
+    DemuxListener demux;
+    for (size_t i = 0; i < uris.size(); ++i) {
+        demux.add(uris[i], *listeners[i]);
+    }
+    auto status = sub->registerListener(containerUri, demux);
+    if (UCode::OK != status.code()){
+        spdlog::error("registerListener failed for the container topic");
+        return -1;
+    }
+
+    /* main is a polling consumer, it reads a consistent snapshot of the values without a lock */
     while (!gTerminate) {
         sleep(1);
+        uint64_t timeInMilliseconds = 0;
+        uint32_t random = 0;
+        uint8_t counter = 0;
+        if (gLatest.read(timeIndex, timeInMilliseconds) != 0 && gLatest.read(randomIndex, random) != 0 &&
+            gLatest.read(counterIndex, counter) != 0) {
+            spdlog::info("latest : time = {}, random = {}, counter = {}", timeInMilliseconds, random, counter);
+        }
     }
 
+    sub->unregisterListener(containerUri, demux);
+
     for (size_t i = 0; i < uris.size(); ++i) {
         auto status = sub->unregisterListener(uris[i], *listeners[i]);
         if (UCode::OK != status.code()){
@@ -173,7 +215,12 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
             return -1;
         }
     }
+
+    if (receiver != nullptr) {
+        receiver->stop();
+    }
  
-    delete sub;
+    sub.reset();
+    SessionPool::instance().clear();
     return 0;
 }
@@ -55,6 +55,7 @@ using namespace uprotocol::v1;
 constexpr int time_id = 1;
 constexpr int rand_id = 2;
 constexpr int count_id = 3;
+constexpr int container_id = 4; // the coalesced updates of the three topics (see Coalescer.h)
 
 static inline auto buildMicrouri(int entity_id, int resource_id) -> UUri {
     auto u_authority = BuildUAuthority().build();
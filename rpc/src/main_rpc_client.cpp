@@ -37,6 +37,9 @@
 
 #include <up-core-api/ustatus.pb.h>
 #include <up-core-api/uri.pb.h>
+#include "SessionPool.h"
+#include "Locator.h"
+#include "Trace.h"
 
 using namespace uprotocol::utransport;
 using namespace uprotocol::uri;
@@ -84,14 +87,22 @@ public:
         callOpt.set_ttl(150);
         // TODO set the token later
         //callOpt.set_token();
-        std::future<RpcResponse> result = this->invokeMethod(uri, payload, callOpt);
+        TraceScope trace_rpc("rpc");
+        std::future<RpcResponse> result {};
+        {
+            TraceScope trace_request("request");
+            result = this->invokeMethod(uri, payload, callOpt);
+        }
     
         if (!result.valid()) {
             spdlog::error("Future is invalid");
             return UPayload(nullptr, 0, UPayloadType::UNDEFINED);
         }
         /* wait for the future to be fullfieled - it is possible also to specify a timeout for the future */
-        result.wait();
+        {
+            TraceScope trace_wait("wait response");
+            result.wait();
+        }
         auto res = result.get();
     
         if (UCode::OK != res.status.code()) {
@@ -107,9 +118,14 @@ public:
 int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
    
     signal(SIGINT, signalHandler);
+    /* UP_TRACE=1 records the stages of every request, trace-rpc_client-<pid>.json is written at exit */
+    if (Tracer::enabledByEnv()) {
+        Tracer::instance().enable();
+        Tracer::instance().nameThread("main");
+    }
     ZenohSessionManagerConfig config{};
     //config.listenKey = "[\"unixpipe/pub.pipe\"]";
-    config.connectKey = "[\"unixpipe/pub.pipe\"]";
+    config.connectKey = getEndpointFromArgs(argc, argv);
     config.listenKey = "";
     //config.connectKey = "[\"unixpipe/pub.pipe\"]";
     //config.listenKey = listen_key;
@@ -118,17 +134,20 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
     config.lowLatency = "true";
     config.scouting_delay = 0;
     
-    RpCDemoClient *rpc = new RpCDemoClient(config);
-    if (UCode::OK != rpc->getSuccess().code()) {
-        spdlog::error("init failed");
-        return -1;
-    }
+    /* the client is opened in the background while the URI is built */
+    auto rpc_future = SessionPool::openAsync<RpCDemoClient>(config);
     
     auto u_authority = BuildUAuthority().build();
     auto u_entity = BuildUEntity().setId(8).setMajorVersion(1).build();
     auto u_resource = BuildUResource().setRpcRequest(7).build(); //BuildUResource().setID(3).build();
     auto rpcUri = BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
     
+    auto rpc = rpc_future.get();
+    if (nullptr == rpc) {
+        spdlog::error("init failed");
+        return -1;
+    }
+    
     //auto rpcUri = LongUriSerializer::deserialize("/test_rpc.app/1/rpc.milliseconds");
 
     while (!gTerminate) {
@@ -147,7 +166,15 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
         sleep(1);
     }
     
-    delete rpc;
+    rpc.reset();
+    
+    if (Tracer::enabled()) {
+        Tracer::instance().disable();
+        auto trace_file = TRACE_PREFIX + "rpc_client-" + std::to_string(getpid()) + ".json";
+        if (!Tracer::instance().write(trace_file, "rpc_client")) {
+            spdlog::error("failed to write {}", trace_file);
+        }
+    }
 
     return 0;
 }
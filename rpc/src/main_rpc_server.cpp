@@ -35,7 +35,9 @@
 #include <up-client-zenoh-cpp/client/upZenohClient.h>
 #include <up-client-zenoh-cpp/rpc/zenohRpcClient.h>
 
-#include "RpcServer.h"
+#include "SessionPool.h"
+#include "Locator.h"
+#include "Trace.h"
 
 #include <spdlog/spdlog.h>
 
@@ -58,9 +60,11 @@ void signalHandler(int signal) {
 class RpcListener : public UListener {
     public:
     
-//    RpcListener(void *context) : context_(context) {}
+    /* the listener doesn't own the session, main closes it after the listener is unregistered */
+    RpcListener(std::weak_ptr<PooledSession> session) : session_(std::move(session)) {}
     
     UStatus onReceive(UMessage &rcv_umsg) override {
+        TraceScope trace_callback("request");
         std::cout << __FILE__ << ":" << __func__ << ":" << __LINE__ << " Got Rpc request\n";
         /* Construct response payload with the current time */
         auto currentTime = std::chrono::system_clock::now();
@@ -77,22 +81,26 @@ class RpcListener : public UListener {
         //auto uuid = Uuidv8Factory::create();
     
     
+        TraceScope trace_response("response");
         auto response = UAttributesBuilder().response(request_attributes.sink(),
                                                       request_attributes.source(),
                                                       request_attributes.priority(),
                                                       request_attributes.id()).build();
         //UAttributes response_attributes = response.build();
         
-        /* Send the response */
+        /* Send the response on the same session the request arrived on instead of opening another one */
+        auto session = session_.lock();
+        if (nullptr == session) {
+            UStatus status;
+            status.set_code(UCode::UNAVAILABLE);
+            return status;
+        }
         UMessage umsg(payload, response);
-       // RpcServer *rpcServer = (RpcServer *)context_;
-        //return rpcServer->send(umsg);
-        auto ret =  UpZenohClient::instance()->send(umsg);
-        return ret;
+        return session->send(umsg);
     
     }
 private:
-    void *context_;
+    std::weak_ptr<PooledSession> session_;
 };
 
 
@@ -101,9 +109,13 @@ private:
 int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
 
     signal(SIGINT, signalHandler);
+    /* UP_TRACE=1 records the stages of every request, trace-rpc_server-<pid>.json is written at exit */
+    if (Tracer::enabledByEnv()) {
+        Tracer::instance().enable();
+    }
     
     ZenohSessionManagerConfig config{};
-    config.listenKey = "[\"unixpipe/pub.pipe\"]";
+    config.listenKey = getEndpointFromArgs(argc, argv);
     //config.connectKey = "[\"unixpipe/pub.pipe\"]";
     //config.listenKey = listen_key;
     config.connectKey = "";
@@ -111,26 +123,24 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
     config.lowLatency = "true";
     config.scouting_delay = 0;
     
-    RpcServer *transport = new RpcServer(config);
-    auto  status = transport->getSuccess();
-    
-    /* init zenoh utransport */
-//    status = transport->init();
-    if (UCode::OK != status.code()) {
-        spdlog::error("ZenohUTransport init failed");
-        return -1;
-    }
-    RpcListener listner((void *)transport);
-    
+    /* init zenoh utransport in the background while the URI is built */
+    SessionPool::instance().prepare(config);
     
     auto u_authority = BuildUAuthority().build();
     auto u_entity = BuildUEntity().setId(8).setMajorVersion(1).build();
     auto u_resource = BuildUResource().setRpcRequest(7).build(); //BuildUResource().setID(3).build();
     auto rpcUri = BuildUUri().setAutority(u_authority).setEntity(u_entity).setResource(u_resource).build();
     
+    auto transport = SessionPool::instance().acquire(config);
+    if (nullptr == transport) {
+        spdlog::error("ZenohUTransport init failed");
+        return -1;
+    }
+    RpcListener listner(transport);
+    
     
     /* register listener to handle RPC requests */
-    status = transport->registerListener(rpcUri, listner);
+    auto status = transport->registerListener(rpcUri, listner);
     if (UCode::OK != status.code()) {
         spdlog::error("registerListener failed");
         return -1;
@@ -147,6 +157,15 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
     }
 
     /* term zenoh utransport */
-    delete transport;
+    transport.reset();
+    SessionPool::instance().clear();
+    
+    if (Tracer::enabled()) {
+        Tracer::instance().disable();
+        auto trace_file = TRACE_PREFIX + "rpc_server-" + std::to_string(getpid()) + ".json";
+        if (!Tracer::instance().write(trace_file, "rpc_server")) {
+            spdlog::error("failed to write {}", trace_file);
+        }
+    }
     return 0;
 }